@@ -0,0 +1,149 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+
+#include "generator.hpp"
+#include "grid.hpp"
+#include "map.hpp"
+#include "movement.hpp"
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Every benchmark starts from the same seeded state, so the numbers can be
+// compared across commits.
+namespace {
+
+constexpr std::uint64_t seed = 2022;
+
+// A map halfway through generation, with its free positions and
+// connections up to date.
+template<std::size_t width, std::size_t height, typename Walls>
+auto halfway(half_map<width, height, Walls> hm) {
+  hm.seed(seed, 0);
+  hm.update_free_positions_and_connections();
+  const auto total = hm.free_positions.size();
+  while (hm.free_positions.size() > total / 2 && hm.add_wall())
+    ;
+  hm.update_free_positions_and_connections();
+  return hm;
+}
+
+template<std::size_t width, std::size_t height, typename Walls>
+void bench_phases(const half_map<width, height, Walls> & start) {
+  const auto name = [](std::string_view phase) {
+    return fmt::format("{} {}x{}", phase, width, height);
+  };
+  const auto middle = halfway(start);
+
+  // The scans start over on every call, so they can run on the same map.
+  BENCHMARK_ADVANCED(name("collect_valid_starting_positions"))(Catch::Benchmark::Chronometer meter) {
+    auto hm = middle;
+    meter.measure([&] { hm.collect_valid_starting_positions(); });
+  };
+
+  BENCHMARK_ADVANCED(name("collect_connections"))(Catch::Benchmark::Chronometer meter) {
+    auto hm = middle;
+    meter.measure([&] { hm.collect_connections(); });
+  };
+
+  // The walk fills the blocks it reaches, so every run gets its own copy
+  // of the map.
+  BENCHMARK_ADVANCED(name("expand_wall"))(Catch::Benchmark::Chronometer meter) {
+    std::vector<half_map<width, height, Walls>> maps(static_cast<std::size_t>(meter.runs()), middle);
+    const auto p = middle.free_positions[middle.free_positions.size() / 2];
+    meter.measure([&](int i) { return maps[static_cast<std::size_t>(i)].expand_wall(p); });
+  };
+
+  // A single add_wall is too short to give each run its own copy of the
+  // map, this times the add_wall calls of the second half of a generation.
+  BENCHMARK_ADVANCED(name("add_wall second half"))(Catch::Benchmark::Chronometer meter) {
+    std::vector<half_map<width, height, Walls>> maps(static_cast<std::size_t>(meter.runs()), middle);
+    meter.measure([&](int i) {
+      auto & hm = maps[static_cast<std::size_t>(i)];
+      while (hm.add_wall())
+        ;
+    });
+  };
+
+  BENCHMARK(name("create_random_map")) {
+    return create_random_map(start, seed, 0);
+  };
+
+  maze_generator generator(start);
+  BENCHMARK(name("maze_generator")) {
+    return generator.generate(seed).none(0, 0, 1, 1);
+  };
+
+  const auto generated = create_random_map(start, seed, 0);
+  BENCHMARK(name("map mirror")) {
+    return map{ generated };
+  };
+
+  const map full{ generated };
+  BENCHMARK(name("movement masks")) {
+    return movement_masks<mirrored_width(width), height>(full).packed[0];
+  };
+
+  BENCHMARK(name("format map")) {
+    std::string out;
+    fmt::format_to(std::back_inserter(out), "{}", full);
+    return out.size();
+  };
+}
+
+// The same scan of a grid as hand-written loops, a grid_range and its
+// rows, each summing the positions of the cells that pass a cheap test so
+// that the loop cannot be folded.
+void bench_iteration(int width, int height) {
+  const auto name = [&](std::string_view loop) {
+    return fmt::format("{} {}x{}", loop, width, height);
+  };
+  const auto keep = [](position p) {
+    return ((p.x ^ p.y) & 3) == 0;
+  };
+
+  BENCHMARK(name("nested loops")) {
+    long sum = 0;
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        if (keep({ x, y }))
+          sum += x + y;
+      }
+    }
+    return sum;
+  };
+
+  BENCHMARK(name("grid_range")) {
+    long sum = 0;
+    for (const position p : grid_range({ 0, 0 }, { width, height })) {
+      if (keep(p))
+        sum += p.x + p.y;
+    }
+    return sum;
+  };
+
+  BENCHMARK(name("grid_range rows")) {
+    long sum = 0;
+    for (const auto row : grid_range({ 0, 0 }, { width, height }).rows()) {
+      for (const position p : row) {
+        if (keep(p))
+          sum += p.x + p.y;
+      }
+    }
+    return sum;
+  };
+}
+
+} // namespace
+
+TEST_CASE("Position iteration", "[bench]") {
+  bench_iteration(16, 31);
+  bench_iteration(256, 256);
+}
+
+TEST_CASE("Generation phases", "[bench]") {
+  bench_phases(create_map_template());
+  bench_phases(create_empty_template<32, 64>());
+  bench_phases(create_empty_template<64, 128>());
+}
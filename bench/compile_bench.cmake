@@ -0,0 +1,135 @@
+# Times the compile-time generation of constexpr_maps.cpp for each entry of
+# CONFIGS ("<width>x<height>x<count>", separated by |) and writes one CSV
+# row per entry to OUTPUT.
+#
+# Recorded per entry:
+#  - wall_s:        wall time of the compiler run (-fsyntax-only)
+#  - max_rss_kb:    peak resident memory, when GNU time is available
+#  - constexpr_s:   time GCC reports for "constant expression evaluation"
+#  - constexpr_mem: memory GCC reports for the same phase
+#  - ops:           with MEASURE_OPS, the smallest -fconstexpr-ops-limit (GCC)
+#                   or -fconstexpr-steps (Clang) the entry compiles with,
+#                   found by bisection to within 0.1%
+#
+# Run through the maze_builder_compile_bench target.
+cmake_minimum_required(VERSION 3.23) # string(TIMESTAMP) %f
+
+string(REPLACE "|" ";" CONFIGS "${CONFIGS}")
+string(REPLACE "|" ";" INCLUDE_DIRS "${INCLUDE_DIRS}")
+
+if (COMPILER_ID STREQUAL "GNU")
+    set(limit_flag "-fconstexpr-ops-limit=")
+    set(unlimited 9999999999999)
+    set(report_flags -ftime-report)
+elseif (COMPILER_ID MATCHES "Clang")
+    set(limit_flag "-fconstexpr-steps=")
+    set(unlimited 2147483647)
+    set(report_flags)
+else ()
+    message(FATAL_ERROR "compile_bench.cmake supports GCC and Clang, not ${COMPILER_ID}")
+endif ()
+
+set(include_flags)
+foreach (dir IN LISTS INCLUDE_DIRS)
+    list(APPEND include_flags "-I${dir}")
+endforeach ()
+
+find_program(GNU_TIME NAMES time gtime PATHS /usr/bin /usr/local/bin NO_DEFAULT_PATH)
+if (GNU_TIME)
+    execute_process(COMMAND ${GNU_TIME} --version OUTPUT_VARIABLE version ERROR_VARIABLE version)
+    if (NOT version MATCHES "GNU")
+        unset(GNU_TIME)
+    endif ()
+endif ()
+
+# compile(<width> <height> <count> <limit> <prefix>) sets <prefix>_ok,
+# <prefix>_wall_s, <prefix>_max_rss_kb and <prefix>_report.
+function(compile width height count limit prefix)
+    set(command ${COMPILER} ${STD_FLAG} -fsyntax-only "${limit_flag}${limit}" ${report_flags}
+        -DMAZE_BENCH_WIDTH=${width} -DMAZE_BENCH_HEIGHT=${height} -DMAZE_BENCH_COUNT=${count}
+        ${include_flags} ${SOURCE})
+    set(rss_file "${CMAKE_CURRENT_BINARY_DIR}/compile_bench_rss.txt")
+    if (GNU_TIME)
+        list(PREPEND command ${GNU_TIME} -f "%M" -o ${rss_file})
+    endif ()
+
+    string(TIMESTAMP start "%s%f")
+    execute_process(COMMAND ${command} RESULT_VARIABLE result OUTPUT_QUIET ERROR_VARIABLE report)
+    string(TIMESTAMP end "%s%f")
+    math(EXPR micros "${end} - ${start}")
+    math(EXPR seconds "${micros} / 1000000")
+    math(EXPR fraction "${micros} % 1000000 / 1000")
+    string(LENGTH "${fraction}" digits)
+    while (digits LESS 3)
+        string(PREPEND fraction "0")
+        math(EXPR digits "${digits} + 1")
+    endwhile ()
+
+    set(rss "n/a")
+    if (GNU_TIME AND EXISTS ${rss_file})
+        file(STRINGS ${rss_file} rss REGEX "^[0-9]+$")
+    endif ()
+
+    if (result EQUAL 0)
+        set(${prefix}_ok TRUE PARENT_SCOPE)
+    else ()
+        set(${prefix}_ok FALSE PARENT_SCOPE)
+    endif ()
+    set(${prefix}_wall_s "${seconds}.${fraction}" PARENT_SCOPE)
+    set(${prefix}_max_rss_kb "${rss}" PARENT_SCOPE)
+    set(${prefix}_report "${report}" PARENT_SCOPE)
+endfunction()
+
+set(csv "compiler,width,height,count,wall_s,max_rss_kb,constexpr_s,constexpr_mem,ops\n")
+foreach (config IN LISTS CONFIGS)
+    if (NOT config MATCHES "^([0-9]+)x([0-9]+)x([0-9]+)$")
+        message(FATAL_ERROR "invalid configuration '${config}', expected <width>x<height>x<count>")
+    endif ()
+    set(width ${CMAKE_MATCH_1})
+    set(height ${CMAKE_MATCH_2})
+    set(count ${CMAKE_MATCH_3})
+
+    compile(${width} ${height} ${count} ${unlimited} run)
+    if (NOT run_ok)
+        message(FATAL_ERROR "${config} does not compile:\n${run_report}")
+    endif ()
+
+    set(constexpr_s "n/a")
+    set(constexpr_mem "n/a")
+    if (run_report MATCHES "constant expression evaluation *: *[0-9.]+ *\\([ 0-9]+%\\) *[0-9.]+ *\\([ 0-9]+%\\) *([0-9.]+) *\\([ 0-9]+%\\) *([0-9.]+[kMG]?)")
+        set(constexpr_s ${CMAKE_MATCH_1})
+        set(constexpr_mem ${CMAKE_MATCH_2})
+    endif ()
+
+    set(ops "n/a")
+    if (MEASURE_OPS)
+        set(low 0)
+        set(high 1000000)
+        compile(${width} ${height} ${count} ${high} probe)
+        while (NOT probe_ok)
+            set(low ${high})
+            math(EXPR high "${high} * 4")
+            compile(${width} ${height} ${count} ${high} probe)
+        endwhile ()
+        math(EXPR tolerance "${high} / 1000")
+        math(EXPR gap "${high} - ${low}")
+        while (gap GREATER tolerance)
+            math(EXPR middle "${low} + ${gap} / 2")
+            compile(${width} ${height} ${count} ${middle} probe)
+            if (probe_ok)
+                set(high ${middle})
+            else ()
+                set(low ${middle})
+            endif ()
+            math(EXPR gap "${high} - ${low}")
+        endwhile ()
+        set(ops ${high})
+    endif ()
+
+    message(STATUS "${COMPILER_ID} ${width}x${height} x${count}: ${run_wall_s}s, max rss ${run_max_rss_kb} kB, "
+            "constexpr ${constexpr_s}s / ${constexpr_mem}, ops ${ops}")
+    string(APPEND csv "${COMPILER_ID},${width},${height},${count},${run_wall_s},${run_max_rss_kb},${constexpr_s},${constexpr_mem},${ops}\n")
+endforeach ()
+
+file(WRITE ${OUTPUT} "${csv}")
+message(STATUS "Results written to ${OUTPUT}")
@@ -0,0 +1,40 @@
+// Generates MAZE_BENCH_COUNT maps of MAZE_BENCH_WIDTH x MAZE_BENCH_HEIGHT
+// in a single constant expression, for compile_bench.cmake to time.
+#include "map.hpp"
+#include <array>
+#include <utility>
+
+#ifndef MAZE_BENCH_WIDTH
+#define MAZE_BENCH_WIDTH 16
+#endif
+#ifndef MAZE_BENCH_HEIGHT
+#define MAZE_BENCH_HEIGHT 31
+#endif
+#ifndef MAZE_BENCH_COUNT
+#define MAZE_BENCH_COUNT 1
+#endif
+
+namespace {
+
+constexpr std::size_t width = MAZE_BENCH_WIDTH;
+constexpr std::size_t height = MAZE_BENCH_HEIGHT;
+
+constexpr auto create_template() {
+  if constexpr (width == 16 && height == 31)
+    return create_map_template();
+  else
+    return create_empty_template<width, height>();
+}
+
+template<std::size_t... index>
+constexpr auto generate(std::index_sequence<index...>) {
+  return std::array{ map{ create_random_map(create_template(), 2022, index) }... };
+}
+
+constexpr auto maps = generate(std::make_index_sequence<MAZE_BENCH_COUNT>{});
+
+} // namespace
+
+int main() {
+  return maps[0].walls[0, 0] ? 0 : 1;
+}
@@ -0,0 +1,374 @@
+#pragma once
+#include "corridors.hpp"
+#include "map.hpp"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Binary archives of generated maps, written once and read in place.
+//
+// Layout, all integers little-endian:
+//
+//   header   "MZBA", version (u32), count (u64), index offset (u64)
+//   payloads one per map, each 8-byte aligned:
+//            half width (u32), height (u32), junctions (u32), segments
+//            (u32), flags (u32), zero (u32), then the walls of the half
+//            map as rows of 64-bit words, cell x of a row in bit x % 64
+//            of word x / 64, rows padded to whole words
+//            then, when the graph flag is set, the junctions as x, y
+//            (i32), the segments as from, to, length (u32) and the
+//            junction distance table (u32), each padded to 8 bytes
+//   index    count offsets (u64) of the payloads, from the start of the file
+//
+// Only the half map is stored, a map is its mirror. A map stored without
+// its graph has no junctions and no segments; one stored with a graph may
+// have neither either, when it has no corridors.
+namespace archive {
+
+static_assert(std::endian::native == std::endian::little, "archives are read in place, which assumes a little-endian host");
+
+inline constexpr char magic[4] = { 'M', 'Z', 'B', 'A' };
+inline constexpr std::uint32_t version = 1;
+
+// Payload flags.
+inline constexpr std::uint32_t graph_flag = 1;
+
+struct header {
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t count;
+  std::uint64_t index_offset;
+};
+
+struct payload_header {
+  std::uint32_t half_width;
+  std::uint32_t height;
+  std::uint32_t junctions;
+  std::uint32_t segments;
+  std::uint32_t flags;
+  std::uint32_t zero;
+};
+
+constexpr std::size_t words_per_row(std::size_t half_width) {
+  return (half_width + 63) / 64;
+}
+
+constexpr std::uint64_t padded(std::uint64_t bytes) {
+  return (bytes + 7) / 8 * 8;
+}
+
+// A map of an archive, read straight from the mapped file, with its
+// corridor graph when it was stored with one.
+class map_view {
+public:
+  map_view(const payload_header & header, const std::uint64_t * words)
+    : half_width(header.half_width),
+      rows(header.height),
+      stride(words_per_row(header.half_width)),
+      words(words),
+      junction_total(header.junctions),
+      segment_total(header.segments),
+      graph(header.flags & graph_flag) {
+    const auto * graph = reinterpret_cast<const std::byte *>(words + stride * rows);
+    junction_list = reinterpret_cast<const position *>(graph);
+    graph += padded(junction_total * sizeof(position));
+    segment_list = reinterpret_cast<const corridor_graph::segment *>(graph);
+    graph += padded(segment_total * sizeof(corridor_graph::segment));
+    distances = reinterpret_cast<const std::uint32_t *>(graph);
+  }
+
+  std::size_t width() const {
+    return half_width * 2;
+  }
+
+  std::size_t height() const {
+    return rows;
+  }
+
+  bool operator[](std::size_t x, std::size_t y) const {
+    if (x >= half_width)
+      x = width() - 1 - x;
+    return (words[y * stride + x / 64] >> (x % 64)) & 1u;
+  }
+
+  bool has_graph() const {
+    return graph;
+  }
+
+  std::size_t junction_count() const {
+    return junction_total;
+  }
+
+  position junction(std::size_t i) const {
+    return junction_list[i];
+  }
+
+  std::size_t segment_count() const {
+    return segment_total;
+  }
+
+  corridor_graph::segment segment(std::size_t i) const {
+    return segment_list[i];
+  }
+
+  // See corridor_graph::junction_distance.
+  std::uint32_t junction_distance(std::size_t from, std::size_t to) const {
+    return distances[from * junction_total + to];
+  }
+
+  // Bytes of a payload after its header.
+  static std::uint64_t body_size(const payload_header & header) {
+    const std::uint64_t junctions = header.junctions;
+    return words_per_row(header.half_width) * std::uint64_t{ header.height } * sizeof(std::uint64_t) +
+           padded(junctions * sizeof(position)) + padded(header.segments * sizeof(corridor_graph::segment)) +
+           padded(junctions * junctions * sizeof(std::uint32_t));
+  }
+
+private:
+  std::size_t half_width;
+  std::size_t rows;
+  std::size_t stride;
+  const std::uint64_t * words;
+  std::size_t junction_total;
+  std::size_t segment_total;
+  bool graph;
+  const position * junction_list;
+  const corridor_graph::segment * segment_list;
+  const std::uint32_t * distances;
+};
+
+// Appends maps to a new archive at `path`. finish() writes the index, an
+// archive without it is rejected by the reader.
+class writer {
+public:
+  explicit writer(const std::filesystem::path & path)
+    : out(path, std::ios::binary | std::ios::trunc) {
+    if (!out)
+      throw std::runtime_error("cannot create archive " + path.string());
+    out.exceptions(std::ios::failbit | std::ios::badbit);
+    const header empty{};
+    write(empty);
+  }
+
+  // Maps are stored with `graph`, their corridor graph, when given one.
+  template<std::size_t width, std::size_t height, typename Walls>
+  void add(const half_map<width, height, Walls> & hm, const corridor_graph * graph = nullptr) {
+    add(hm.extent.width, hm.extent.height, graph, [&](std::size_t x, std::size_t y) { return bool(hm.walls[x, y]); });
+  }
+
+  // The left half of `m`.
+  template<std::size_t width, std::size_t height>
+  void add(const map<width, height> & m, const corridor_graph * graph = nullptr) {
+    add(m.walls.extent.width / 2, m.walls.extent.height, graph,
+        [&](std::size_t x, std::size_t y) { return bool(m.walls[x, y]); });
+  }
+
+  template<std::size_t width, std::size_t height>
+  void add(const packed_map<width, height> & m, const corridor_graph * graph = nullptr) {
+    add(m.half(), m.extent.height, graph, [&](std::size_t x, std::size_t y) { return m[x, y]; });
+  }
+
+  void finish() {
+    const header complete{ { magic[0], magic[1], magic[2], magic[3] }, version, offsets.size(), position };
+    for (const std::uint64_t offset : offsets)
+      write(offset);
+    out.seekp(0);
+    write(complete);
+    out.close();
+  }
+
+private:
+  template<typename Wall>
+  void add(std::size_t half_width, std::size_t height, const corridor_graph * graph, Wall wall) {
+    offsets.push_back(position);
+    const auto junctions = static_cast<std::uint32_t>(graph ? graph->junctions.size() : 0);
+    const auto segments = static_cast<std::uint32_t>(graph ? graph->segments.size() : 0);
+    write(payload_header{ static_cast<std::uint32_t>(half_width), static_cast<std::uint32_t>(height), junctions, segments,
+                          graph ? graph_flag : 0, 0 });
+    row.assign(words_per_row(half_width), 0);
+    for (std::size_t y = 0; y < height; y++) {
+      std::ranges::fill(row, 0);
+      for (std::size_t x = 0; x < half_width; x++) {
+        if (wall(x, y))
+          row[x / 64] |= std::uint64_t{ 1 } << (x % 64);
+      }
+      write_padded(std::span<const std::uint64_t>(row));
+    }
+    if (graph) {
+      write_padded(std::span<const ::position>(graph->junctions));
+      write_padded(std::span<const corridor_graph::segment>(graph->segments));
+      write_padded(std::span<const std::uint32_t>(graph->distances));
+    }
+  }
+
+  template<typename T>
+  void write(const T & value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    position += sizeof(value);
+  }
+
+  // `values` followed by zeros up to the next multiple of 8 bytes.
+  template<typename T>
+  void write_padded(std::span<const T> values) {
+    const std::uint64_t bytes = values.size_bytes();
+    out.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(bytes));
+    const char zeros[8] = {};
+    out.write(zeros, static_cast<std::streamsize>(padded(bytes) - bytes));
+    position += padded(bytes);
+  }
+
+  std::ofstream out;
+  std::uint64_t position = 0;
+  std::vector<std::uint64_t> offsets;
+  std::vector<std::uint64_t> row;
+};
+
+// Maps an archive into memory. The header and the index are checked on
+// open, a payload whenever it is looked up; the maps themselves are never
+// copied.
+class reader {
+public:
+  explicit reader(const std::filesystem::path & path) {
+    map_file(path);
+    try {
+      if (size < sizeof(header))
+        throw std::runtime_error("archive is too small for its header");
+      std::memcpy(&head, data, sizeof(head));
+      if (std::memcmp(head.magic, magic, sizeof(magic)) != 0)
+        throw std::runtime_error("not a map archive");
+      if (head.version != version)
+        throw std::runtime_error("unsupported archive version " + std::to_string(head.version));
+      if (head.index_offset % alignof(std::uint64_t) != 0 || head.index_offset > size ||
+          head.count > (size - head.index_offset) / sizeof(std::uint64_t))
+        throw std::runtime_error("archive index is out of bounds");
+    } catch (...) {
+      unmap_file();
+      throw;
+    }
+    index = reinterpret_cast<const std::uint64_t *>(data + head.index_offset);
+  }
+
+  reader(reader && other) noexcept
+    : data(std::exchange(other.data, nullptr)),
+      size(std::exchange(other.size, 0)),
+      head(other.head),
+      index(other.index) {
+  }
+
+  reader & operator=(reader && other) noexcept {
+    if (this != &other) {
+      unmap_file();
+      data = std::exchange(other.data, nullptr);
+      size = std::exchange(other.size, 0);
+      head = other.head;
+      index = other.index;
+    }
+    return *this;
+  }
+
+  ~reader() {
+    unmap_file();
+  }
+
+  std::size_t count() const {
+    return head.count;
+  }
+
+  map_view operator[](std::size_t i) const {
+    if (i >= head.count)
+      throw std::out_of_range("map " + std::to_string(i) + " is not in the archive");
+    const std::uint64_t offset = index[i];
+    if (offset % alignof(std::uint64_t) != 0 || offset > head.index_offset ||
+        head.index_offset - offset < sizeof(payload_header))
+      throw std::runtime_error("payload " + std::to_string(i) + " is out of bounds");
+    payload_header payload;
+    std::memcpy(&payload, data + offset, sizeof(payload));
+    // The distance table must fit before its size can be computed.
+    const std::uint64_t rest = head.index_offset - offset - sizeof(payload_header);
+    if ((payload.junctions > 0 && rest / sizeof(std::uint32_t) / payload.junctions < payload.junctions) ||
+        rest < map_view::body_size(payload))
+      throw std::runtime_error("payload " + std::to_string(i) + " is out of bounds");
+    if ((payload.flags & ~graph_flag) != 0 || payload.zero != 0 ||
+        (!(payload.flags & graph_flag) && (payload.junctions > 0 || payload.segments > 0)))
+      throw std::runtime_error("payload " + std::to_string(i) + " has an invalid header");
+    return { payload, reinterpret_cast<const std::uint64_t *>(data + offset + sizeof(payload_header)) };
+  }
+
+private:
+#if defined(_WIN32)
+  void map_file(const std::filesystem::path & path) {
+    const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      throw std::runtime_error("cannot open archive " + path.string());
+    LARGE_INTEGER file_size;
+    const HANDLE mapping = GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0
+                             ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)
+                             : nullptr;
+    CloseHandle(file);
+    if (!mapping)
+      throw std::runtime_error("cannot map archive " + path.string());
+    data = static_cast<const std::byte *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(mapping);
+    if (!data)
+      throw std::runtime_error("cannot map archive " + path.string());
+    size = static_cast<std::size_t>(file_size.QuadPart);
+  }
+
+  void unmap_file() {
+    if (data)
+      UnmapViewOfFile(data);
+    data = nullptr;
+  }
+#else
+  void map_file(const std::filesystem::path & path) {
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+      throw std::runtime_error("cannot open archive " + path.string());
+    struct stat info;
+    void * address = MAP_FAILED;
+    if (::fstat(file, &info) == 0 && info.st_size > 0)
+      address = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, file, 0);
+    ::close(file);
+    if (address == MAP_FAILED)
+      throw std::runtime_error("cannot map archive " + path.string());
+    data = static_cast<const std::byte *>(address);
+    size = static_cast<std::size_t>(info.st_size);
+  }
+
+  void unmap_file() {
+    if (data)
+      ::munmap(const_cast<std::byte *>(data), size);
+    data = nullptr;
+  }
+#endif
+
+  const std::byte * data = nullptr;
+  std::size_t size = 0;
+  header head{};
+  const std::uint64_t * index = nullptr;
+};
+
+} // namespace archive
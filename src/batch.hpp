@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Runs a batch of independent jobs on a pool of threads and hands the
+// results back in job order, whatever the number of threads.
+namespace batch {
+
+// The jobs [begin, end) owned by one worker. The owner takes jobs from
+// the front, idle workers steal the back half.
+class work_queue {
+public:
+  std::optional<std::size_t> pop() {
+    std::scoped_lock lock(mutex);
+    if (begin == end)
+      return std::nullopt;
+    return begin++;
+  }
+
+  std::optional<std::pair<std::size_t, std::size_t>> steal() {
+    std::scoped_lock lock(mutex);
+    const std::size_t count = (end - begin + 1) / 2;
+    if (count == 0)
+      return std::nullopt;
+    end -= count;
+    return std::pair{ end, end + count };
+  }
+
+  void assign(std::pair<std::size_t, std::size_t> range) {
+    std::scoped_lock lock(mutex);
+    std::tie(begin, end) = range;
+  }
+
+private:
+  std::mutex mutex;
+  std::size_t begin = 0;
+  std::size_t end = 0;
+};
+
+// Results waiting for the consumer, per worker. Workers that get this far
+// ahead of the consumer wait for it instead of holding on to more maps.
+inline constexpr std::size_t slots_per_thread = 4;
+
+// generate(index, stop) when it takes the batch's stop token, so that a
+// long job can give up once the batch is stopped.
+template<typename Generate>
+auto generate_one(Generate & generate, std::size_t index, const std::stop_token & stop) {
+  if constexpr (std::is_invocable_v<Generate &, std::size_t, std::stop_token>)
+    return generate(index, stop);
+  else
+    return generate(index);
+}
+
+// Calls `generate(index)` for every index in [0, count) on `threads`
+// workers, and `consume(index, result)` on the calling thread in index
+// order, as soon as the next result is ready. `generate` can also take a
+// std::stop_token as a second argument.
+//
+// Indices are handed out in order, a few at a time, and only within a
+// window of threads * slots_per_thread indices from the next one to
+// consume, so the results in flight live in a ring of that many slots.
+// The first exception thrown by `generate` or `consume` stops the batch:
+// no further index is started, a stop is requested on the token, and the
+// exception is rethrown on the calling thread once the workers have
+// finished. What generate returns after a stop is dropped.
+template<typename Generate, typename Consume>
+void run(std::size_t count, std::size_t threads, Generate generate, Consume consume) {
+  using result_type = decltype(generate_one(generate, std::size_t{}, std::stop_token{}));
+
+  threads = std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(count, 1));
+  const std::size_t window = threads * slots_per_thread;
+  std::vector<work_queue> queues(threads);
+
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::condition_variable room;
+  std::vector<std::optional<result_type>> results(window);
+  // The first index not handed out yet, and the next one to consume.
+  std::size_t next = 0;
+  std::size_t consumed = 0;
+  std::exception_ptr error;
+  std::stop_source stopping;
+
+  const auto fail = [&](std::exception_ptr e) {
+    std::scoped_lock lock(mutex);
+    if (!error)
+      error = std::move(e);
+    stopping.request_stop();
+    ready.notify_one();
+    room.notify_all();
+  };
+
+  // The next index for worker `self`: from its own queue, from the window,
+  // or stolen from another worker. None once the batch is done or stopped.
+  const auto take = [&](std::size_t self) -> std::optional<std::size_t> {
+    while (!stopping.stop_requested()) {
+      if (auto index = queues[self].pop())
+        return index;
+      {
+        std::scoped_lock lock(mutex);
+        if (next < count && next < consumed + window) {
+          const std::size_t end = std::min({ next + slots_per_thread / 2, count, consumed + window });
+          queues[self].assign({ next, end });
+          next = end;
+          continue;
+        }
+      }
+      bool stolen = false;
+      for (std::size_t i = 1; i < threads && !stolen; i++) {
+        if (auto range = queues[(self + i) % threads].steal()) {
+          queues[self].assign(*range);
+          stolen = true;
+        }
+      }
+      if (stolen)
+        continue;
+      std::unique_lock lock(mutex);
+      if (next == count)
+        return std::nullopt;
+      room.wait(lock, [&] { return stopping.stop_requested() || next < consumed + window; });
+    }
+    return std::nullopt;
+  };
+
+  auto work = [&](std::size_t self) {
+    const std::stop_token stop = stopping.get_token();
+    while (auto index = take(self)) {
+      try {
+        auto result = generate_one(generate, *index, stop);
+        std::scoped_lock lock(mutex);
+        results[*index % window].emplace(std::move(result));
+        ready.notify_one();
+      } catch (...) {
+        fail(std::current_exception());
+      }
+    }
+  };
+
+  std::vector<std::jthread> workers;
+  workers.reserve(threads);
+  for (std::size_t i = 0; i < threads; i++)
+    workers.emplace_back(work, i);
+
+  for (std::size_t index = 0; index < count; index++) {
+    std::unique_lock lock(mutex);
+    auto & slot = results[index % window];
+    ready.wait(lock, [&] { return slot.has_value() || error; });
+    if (error)
+      break;
+    auto result = std::move(*slot);
+    slot.reset();
+    consumed = index + 1;
+    lock.unlock();
+    room.notify_all();
+    try {
+      consume(index, std::move(result));
+    } catch (...) {
+      fail(std::current_exception());
+      break;
+    }
+  }
+
+  workers.clear();
+  if (error)
+    std::rethrow_exception(error);
+}
+
+} // namespace batch
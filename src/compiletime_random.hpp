@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include <random>
 
 // From Jason Turner
 // https://www.youtube.com/watch?v=rpn_5Mrrxf8
@@ -15,6 +16,12 @@ constexpr auto seed() {
   return shifted;
 }
 
+// A non-deterministic seed, for callers that do not want reproducible output.
+inline std::uint64_t random_seed() {
+  std::random_device rd;
+  return (std::uint64_t{ rd() } << 32u) | rd();
+}
+
 struct PCG {
   struct pcg32_random_t {
     std::uint64_t state = 0;
@@ -23,13 +30,59 @@ struct PCG {
   pcg32_random_t rng;
   typedef std::uint32_t result_type;
 
+  constexpr PCG() = default;
+
+  // Seeds like pcg32_srandom_r: `initseq` selects one of 2^63 streams.
+  constexpr PCG(std::uint64_t initstate, std::uint64_t initseq) {
+    rng.state = 0;
+    rng.inc = (initseq << 1u) | 1u;
+    pcg32_random_r();
+    rng.state += initstate;
+    pcg32_random_r();
+  }
+
   constexpr result_type operator()() { return pcg32_random_r(); }
 
+  // Skips `delta` outputs in O(log delta) steps, see pcg32_advance_r.
+  // Moving backwards is advancing by 2^64 - n.
+  constexpr void advance(std::uint64_t delta) {
+    std::uint64_t cur_mult = multiplier;
+    std::uint64_t cur_plus = rng.inc | 1;
+    std::uint64_t acc_mult = 1;
+    std::uint64_t acc_plus = 0;
+    while (delta > 0) {
+      if (delta & 1) {
+        acc_mult *= cur_mult;
+        acc_plus = acc_plus * cur_mult + cur_plus;
+      }
+      cur_plus = (cur_mult + 1) * cur_plus;
+      cur_mult *= cur_mult;
+      delta >>= 1;
+    }
+    rng.state = acc_mult * rng.state + acc_plus;
+  }
+
+  constexpr void discard(std::uint64_t count) { advance(count); }
+
+  // The generator `steps` outputs ahead of this one. Worker `k` of a pool
+  // can take jumped(k * length) to own a disjoint block of one sequence.
+  constexpr PCG jumped(std::uint64_t steps) const {
+    PCG copy = *this;
+    copy.advance(steps);
+    return copy;
+  }
+
+  // Streams are independent sequences sharing the same state space.
+  constexpr std::uint64_t stream() const { return rng.inc >> 1u; }
+  constexpr void set_stream(std::uint64_t stream) { rng.inc = (stream << 1u) | 1u; }
+
 private:
+  static constexpr std::uint64_t multiplier = 6364136223846793005ULL;
+
   constexpr std::uint32_t pcg32_random_r() {
     std::uint64_t oldstate = rng.state;
     // Advance internal state
-    rng.state = oldstate * 6364136223846793005ULL + (rng.inc | 1);
+    rng.state = oldstate * multiplier + (rng.inc | 1);
     // Calculate output function (XSH RR), uses old state for max ILP
     std::uint32_t xorshifted = static_cast<std::uint32_t>(((oldstate >> 18u) ^ oldstate) >> 27lu);
     std::uint32_t rot = static_cast<std::uint32_t>(oldstate >> 59lu);
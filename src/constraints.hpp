@@ -0,0 +1,239 @@
+#pragma once
+#include "generator.hpp"
+#include "map.hpp"
+#include "validate.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Generate-and-reject: maps are generated until one meets every
+// constraint, and a map that can no longer meet them is dropped as soon as
+// that is known, in the middle of generation.
+//
+// A constraint is any type with
+//
+//   std::string_view name() const;
+//   // False once more walls cannot make the map acceptable, checked after
+//   // every add_wall.
+//   bool viable(const half_map<...> &) const;
+//   // The verdict on the finished map.
+//   bool accept(const half_map<...> &) const;
+//
+// Densities are wall cells over all cells, and wall groups are counted
+// within the half map, both including the walls of the template.
+namespace constraints {
+
+struct max_density {
+  double limit;
+
+  std::string_view name() const {
+    return "max density";
+  }
+
+  // Walls are only ever added.
+  template<typename HalfMap>
+  bool viable(const HalfMap & hm) const {
+    return accept(hm);
+  }
+
+  template<typename HalfMap>
+  bool accept(const HalfMap & hm) const {
+    return static_cast<double>(hm.wall_cell_count()) <= limit * static_cast<double>(hm.extent.width * hm.extent.height);
+  }
+};
+
+struct min_density {
+  double limit;
+
+  std::string_view name() const {
+    return "min density";
+  }
+
+  template<typename HalfMap>
+  bool viable(const HalfMap &) const {
+    return true;
+  }
+
+  template<typename HalfMap>
+  bool accept(const HalfMap & hm) const {
+    return static_cast<double>(hm.wall_cell_count()) >= limit * static_cast<double>(hm.extent.width * hm.extent.height);
+  }
+};
+
+struct max_wall_group {
+  std::size_t limit;
+
+  std::string_view name() const {
+    return "max wall group";
+  }
+
+  // Groups only grow, by new walls and by merges.
+  template<typename HalfMap>
+  bool viable(const HalfMap & hm) const {
+    return accept(hm);
+  }
+
+  template<typename HalfMap>
+  bool accept(const HalfMap & hm) const {
+    return hm.largest_wall_group() <= limit;
+  }
+};
+
+// The corridors of the mirrored map form a single region. A pocket can
+// still be filled up by later walls, so this is only checked at the end.
+struct connected {
+  std::string_view name() const {
+    return "connected";
+  }
+
+  template<typename HalfMap>
+  bool viable(const HalfMap &) const {
+    return true;
+  }
+
+  template<typename HalfMap>
+  bool accept(const HalfMap & hm) const {
+    return check_playability(map{ hm }).connected();
+  }
+};
+
+// No corridor of the mirrored map ends in a dead end. Walls both create
+// and fill dead ends, so this is only checked at the end.
+struct no_dead_ends {
+  std::string_view name() const {
+    return "no dead ends";
+  }
+
+  template<typename HalfMap>
+  bool viable(const HalfMap &) const {
+    return true;
+  }
+
+  template<typename HalfMap>
+  bool accept(const HalfMap & hm) const {
+    return check_playability(map{ hm }).dead_ends.empty();
+  }
+};
+
+} // namespace constraints
+
+// Any constraint, for a given half map type.
+template<typename HalfMap>
+struct constraint {
+  template<typename C>
+  constraint(C c)
+    : name(c.name()),
+      viable([c](const HalfMap & hm) { return c.viable(hm); }),
+      accept([c](const HalfMap & hm) { return c.accept(hm); }) {
+  }
+
+  std::string_view name;
+  std::function<bool(const HalfMap &)> viable;
+  std::function<bool(const HalfMap &)> accept;
+};
+
+// How many attempts each constraint turned down, charged to the first
+// constraint that failed: `aborted` during generation, `rejected` on the
+// finished map.
+struct rejection_stats {
+  struct entry {
+    std::string_view name;
+    std::size_t aborted = 0;
+    std::size_t rejected = 0;
+  };
+
+  std::size_t attempts = 0;
+  std::size_t accepted = 0;
+  std::vector<entry> constraints;
+
+  // Share of the attempts turned down by constraint `i`.
+  double rejection_rate(std::size_t i) const {
+    return attempts == 0 ? 0.0 : static_cast<double>(constraints[i].aborted + constraints[i].rejected) / static_cast<double>(attempts);
+  }
+
+  rejection_stats & operator+=(const rejection_stats & other) {
+    attempts += other.attempts;
+    accepted += other.accepted;
+    if (constraints.empty())
+      constraints = other.constraints;
+    else {
+      for (std::size_t i = 0; i < constraints.size(); i++) {
+        constraints[i].aborted += other.constraints[i].aborted;
+        constraints[i].rejected += other.constraints[i].rejected;
+      }
+    }
+    return *this;
+  }
+};
+
+// A maze_generator that checks `constraints` in order, after every wall
+// and on the finished map. Like maze_generator, one instance reuses its
+// buffers from one attempt to the next.
+template<std::size_t width, std::size_t height, typename Walls = bitboard<width, height>>
+class rejecting_generator {
+public:
+  using half_map_type = half_map<width, height, Walls>;
+
+  rejecting_generator(half_map_type start, std::vector<constraint<half_map_type>> constraints)
+    : generator(std::move(start)),
+      constraints(std::move(constraints)) {
+    for (const auto & c : this->constraints)
+      counts.constraints.push_back({ c.name });
+  }
+
+  // One attempt with the map of create_random_map(start, seed, stream).
+  // True when it met every constraint, state() then holds it.
+  bool generate(std::uint64_t seed, std::uint64_t stream) {
+    counts.attempts++;
+    std::size_t failed = 0;
+    const bool completed = generator.generate_while(seed, stream, [&](const half_map_type & hm) {
+      for (failed = 0; failed < constraints.size(); failed++) {
+        if (!constraints[failed].viable(hm))
+          return false;
+      }
+      return true;
+    });
+    if (!completed) {
+      counts.constraints[failed].aborted++;
+      return false;
+    }
+    for (failed = 0; failed < constraints.size(); failed++) {
+      if (!constraints[failed].accept(generator.state())) {
+        counts.constraints[failed].rejected++;
+        return false;
+      }
+    }
+    counts.accepted++;
+    return true;
+  }
+
+  const half_map_type & state() const {
+    return generator.state();
+  }
+
+  const rejection_stats & stats() const {
+    return counts;
+  }
+
+  // The stats since the last call, which start over.
+  rejection_stats take_stats() {
+    rejection_stats taken = counts;
+    counts.attempts = 0;
+    counts.accepted = 0;
+    for (auto & entry : counts.constraints)
+      entry.aborted = entry.rejected = 0;
+    return taken;
+  }
+
+private:
+  maze_generator<width, height, Walls> generator;
+  std::vector<constraint<half_map_type>> constraints;
+  rejection_stats counts;
+};
+
+template<std::size_t width, std::size_t height, typename Walls>
+rejecting_generator(half_map<width, height, Walls>, std::vector<constraint<half_map<width, height, Walls>>>)
+  -> rejecting_generator<width, height, Walls>;
@@ -0,0 +1,261 @@
+#pragma once
+#include "batch.hpp"
+#include "map.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+// The corridors of a map as a graph, for pathfinding without a search on
+// the grid. Junctions are the corridor cells with other than two corridor
+// neighbours (forks and dead ends), segments the runs of corridor cells
+// between them. A loop without any junction gets one on its first cell in
+// scan order. The shortest distances between all pairs of junctions are
+// precomputed, so the distance between any two corridor cells is a few
+// table lookups.
+struct corridor_graph {
+  static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+  // `length` steps from junction `from` to junction `to`, which can be the
+  // same junction for a loop.
+  struct segment {
+    std::uint32_t from;
+    std::uint32_t to;
+    std::uint32_t length;
+
+    bool operator==(const segment &) const = default;
+  };
+
+  // Where a cell lies: on a junction, `offset` steps from the `from` end
+  // of a segment, or on neither for a wall.
+  struct place {
+    std::uint32_t junction = none;
+    std::uint32_t segment = none;
+    std::uint32_t offset = 0;
+  };
+
+  std::size_t width = 0;
+  std::size_t height = 0;
+  std::vector<position> junctions;
+  std::vector<segment> segments;
+  // Steps from junction i to junction j at i * junctions.size() + j, none
+  // when they are not connected.
+  std::vector<std::uint32_t> distances;
+  // The place of every cell, row by row.
+  std::vector<place> places;
+
+  std::uint32_t junction_distance(std::size_t from, std::size_t to) const {
+    return distances[from * junctions.size() + to];
+  }
+
+  const place & place_of(position p) const {
+    return places[static_cast<std::size_t>(p.y) * width + static_cast<std::size_t>(p.x)];
+  }
+
+  // Steps between two corridor cells, none when either is a wall or they
+  // are not connected.
+  std::uint32_t distance(position a, position b) const {
+    const place & pa = place_of(a);
+    const place & pb = place_of(b);
+    std::uint32_t best = none;
+    if (pa.segment != none && pa.segment == pb.segment)
+      best = pa.offset > pb.offset ? pa.offset - pb.offset : pb.offset - pa.offset;
+    for (const auto & [ja, to_a] : ends(pa)) {
+      for (const auto & [jb, to_b] : ends(pb)) {
+        if (ja == none || jb == none)
+          continue;
+        const std::uint32_t between = junction_distance(ja, jb);
+        if (between != none)
+          best = std::min(best, to_a + between + to_b);
+      }
+    }
+    return best;
+  }
+
+private:
+  // The junctions a place is reached through, with the steps to each.
+  std::array<std::pair<std::uint32_t, std::uint32_t>, 2> ends(const place & p) const {
+    if (p.junction != none)
+      return { { { p.junction, 0 }, { none, 0 } } };
+    if (p.segment == none)
+      return { { { none, 0 }, { none, 0 } } };
+    const segment & s = segments[p.segment];
+    return { { { s.from, p.offset }, { s.to, s.length - p.offset } } };
+  }
+};
+
+namespace corridor_detail {
+
+// The segments as edges both ways, grouped by junction: the edges of
+// junction j are edges[first_edge[j]] to edges[first_edge[j + 1]], as
+// (junction, length) pairs.
+struct junction_edges {
+  std::vector<std::uint32_t> first_edge;
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> edges;
+  std::uint32_t longest = 0;
+};
+
+// Shortest distances from a junction to every other with a bucket queue:
+// lengths are small integers, so the junctions are settled in order of
+// distance from a ring of `longest + 1` buckets, without a heap. The
+// buckets keep their capacity from one source to the next.
+class distance_search {
+public:
+  explicit distance_search(const junction_edges & graph)
+    : graph(graph),
+      buckets(graph.longest + 1) {
+  }
+
+  void run(std::uint32_t source, std::span<std::uint32_t> distances) {
+    std::ranges::fill(distances, corridor_graph::none);
+    distances[source] = 0;
+    buckets[0].push_back(source);
+    std::size_t pending = 1;
+    for (std::uint32_t distance = 0; pending > 0; distance++) {
+      auto & bucket = buckets[distance % buckets.size()];
+      // Edges are at least 1 long, nothing is added to this bucket while
+      // it is read.
+      for (const std::uint32_t junction : bucket) {
+        if (distances[junction] != distance)
+          continue;
+        for (std::uint32_t e = graph.first_edge[junction]; e < graph.first_edge[junction + 1]; e++) {
+          const auto [to, length] = graph.edges[e];
+          if (distance + length < distances[to]) {
+            distances[to] = distance + length;
+            buckets[distances[to] % buckets.size()].push_back(to);
+            pending++;
+          }
+        }
+      }
+      pending -= bucket.size();
+      bucket.clear();
+    }
+  }
+
+private:
+  const junction_edges & graph;
+  std::vector<std::vector<std::uint32_t>> buckets;
+};
+
+} // namespace corridor_detail
+
+// Builds the corridor graph of `m`. The rows of the distance table are
+// computed on `threads` threads; batches of maps are better served by one
+// thread per map.
+template<std::size_t width, std::size_t height>
+corridor_graph build_corridor_graph(const map<width, height> & m, std::size_t threads = 1) {
+  corridor_graph graph;
+  graph.width = m.walls.extent.width;
+  graph.height = m.walls.extent.height;
+  graph.places.assign(graph.width * graph.height, {});
+
+  const auto open = [&](position p) {
+    return p.x >= 0 && p.y >= 0 && static_cast<std::size_t>(p.x) < graph.width &&
+           static_cast<std::size_t>(p.y) < graph.height &&
+           !m.walls[static_cast<std::size_t>(p.x), static_cast<std::size_t>(p.y)];
+  };
+  const std::array<position, 4> steps = { { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } } };
+  const auto neighbours = [&](position p) {
+    int count = 0;
+    for (const position step : steps)
+      count += open({ p.x + step.x, p.y + step.y });
+    return count;
+  };
+  const auto at = [&](position p) -> corridor_graph::place & {
+    return graph.places[static_cast<std::size_t>(p.y) * graph.width + static_cast<std::size_t>(p.x)];
+  };
+  const auto add_junction = [&](position p) {
+    at(p).junction = static_cast<std::uint32_t>(graph.junctions.size());
+    graph.junctions.push_back(p);
+  };
+
+  // Every segment is walked once, from the first of its ends to get
+  // there: a walk stops where an earlier one already went.
+  const auto walk_from = [&](std::uint32_t from) {
+    const position start = graph.junctions[from];
+    for (const position step : steps) {
+      position previous = start;
+      position p{ start.x + step.x, start.y + step.y };
+      if (!open(p) || at(p).segment != corridor_graph::none)
+        continue;
+      if (at(p).junction != corridor_graph::none) {
+        if (from < at(p).junction)
+          graph.segments.push_back({ from, at(p).junction, 1 });
+        continue;
+      }
+      const auto segment = static_cast<std::uint32_t>(graph.segments.size());
+      std::uint32_t length = 1;
+      while (at(p).junction == corridor_graph::none) {
+        at(p).segment = segment;
+        at(p).offset = length++;
+        for (const position next_step : steps) {
+          const position next{ p.x + next_step.x, p.y + next_step.y };
+          if (open(next) && next != previous) {
+            previous = std::exchange(p, next);
+            break;
+          }
+        }
+      }
+      graph.segments.push_back({ from, at(p).junction, length });
+    }
+  };
+
+  for (int y = 0; y < static_cast<int>(graph.height); y++) {
+    for (int x = 0; x < static_cast<int>(graph.width); x++) {
+      if (open({ x, y }) && neighbours({ x, y }) != 2)
+        add_junction({ x, y });
+    }
+  }
+  for (std::uint32_t j = 0; j < graph.junctions.size(); j++)
+    walk_from(j);
+  for (int y = 0; y < static_cast<int>(graph.height); y++) {
+    for (int x = 0; x < static_cast<int>(graph.width); x++) {
+      if (open({ x, y }) && at({ x, y }).junction == corridor_graph::none && at({ x, y }).segment == corridor_graph::none) {
+        add_junction({ x, y });
+        walk_from(static_cast<std::uint32_t>(graph.junctions.size() - 1));
+      }
+    }
+  }
+
+  // Loops never shorten a path and are left out.
+  const std::size_t n = graph.junctions.size();
+  corridor_detail::junction_edges edges;
+  edges.first_edge.assign(n + 1, 0);
+  for (const auto & s : graph.segments) {
+    if (s.from != s.to) {
+      edges.first_edge[s.from + 1]++;
+      edges.first_edge[s.to + 1]++;
+      edges.longest = std::max(edges.longest, s.length);
+    }
+  }
+  for (std::size_t j = 0; j < n; j++)
+    edges.first_edge[j + 1] += edges.first_edge[j];
+  edges.edges.resize(edges.first_edge[n]);
+  std::vector<std::uint32_t> filled(edges.first_edge.begin(), edges.first_edge.end() - 1);
+  for (const auto & s : graph.segments) {
+    if (s.from != s.to) {
+      edges.edges[filled[s.from]++] = { s.to, s.length };
+      edges.edges[filled[s.to]++] = { s.from, s.length };
+    }
+  }
+
+  // A few chunks of rows per thread. Each chunk writes its own rows of the
+  // table in place, so there is nothing to hand back.
+  graph.distances.resize(n * n);
+  const std::size_t chunks = threads <= 1 ? 1 : std::min(n, threads * 4);
+  const auto search_rows = [&](std::size_t chunk) {
+    corridor_detail::distance_search search(edges);
+    for (std::size_t source = n * chunk / chunks; source < n * (chunk + 1) / chunks; source++)
+      search.run(static_cast<std::uint32_t>(source), std::span(graph.distances).subspan(source * n, n));
+    return chunk;
+  };
+  if (chunks == 1)
+    search_rows(0);
+  else
+    batch::run(chunks, threads, search_rows, [](std::size_t, std::size_t) {});
+  return graph;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "map.hpp"
+#include <cstdint>
+#include <utility>
+
+// Generates maps from one template over and over in the same workspace.
+// Every buffer of the half map (free positions, connections, wall groups,
+// the expand_wall stack) keeps its capacity from one map to the next, so
+// once the first map is generated the next ones allocate nothing.
+//
+// generate() produces the half of the map create_random_map() returns for
+// the same template, seed and stream.
+template<std::size_t width, std::size_t height, typename Walls = bitboard<width, height>>
+class maze_generator {
+public:
+  constexpr explicit maze_generator(half_map<width, height, Walls> start)
+    : start(std::move(start)),
+      workspace(this->start) {
+  }
+
+  // The walls of the generated half map, valid until the next call.
+  constexpr const Walls & generate(std::uint64_t seed, std::uint64_t stream = 0) {
+    generate_while(seed, stream, [](const auto &) { return true; });
+    return workspace.walls;
+  }
+
+  // Generates like generate(), but calls `viable(state())` after every
+  // wall and stops as soon as it returns false. Returns whether the map
+  // was completed.
+  template<typename Viable>
+  constexpr bool generate_while(std::uint64_t seed, std::uint64_t stream, Viable viable) {
+    workspace.walls = start.walls;
+    workspace.collected = false;
+    workspace.pending_blocks.clear();
+    workspace.seed(seed, stream);
+    while (workspace.add_wall()) {
+      if (!viable(std::as_const(workspace)))
+        return false;
+    }
+    return true;
+  }
+
+  // The whole workspace after the last generate(), for inspection.
+  constexpr const half_map<width, height, Walls> & state() const {
+    return workspace;
+  }
+
+private:
+  half_map<width, height, Walls> start;
+  half_map<width, height, Walls> workspace;
+};
+
+template<std::size_t width, std::size_t height, typename Walls>
+maze_generator(half_map<width, height, Walls>) -> maze_generator<width, height, Walls>;
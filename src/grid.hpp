@@ -0,0 +1,157 @@
+#pragma once
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+
+struct position {
+  int x, y;
+  bool operator==(const position &) const = default;
+};
+
+// The positions of the rectangle [top_left, bottom_right), row by row.
+// A random-access, sized view whose increment is the inner step of two
+// nested loops: one compare, and a carry to the next row at its end.
+// rows() splits it into one view per row, for loops that work a row at
+// a time and want no carry at all.
+class grid_range : public std::ranges::view_interface<grid_range> {
+public:
+  class iterator {
+  public:
+    using iterator_concept = std::random_access_iterator_tag;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = position;
+    using difference_type = std::ptrdiff_t;
+
+    constexpr iterator() = default;
+
+    constexpr iterator(position current, int left, int right)
+      : current(current),
+        left(left),
+        right(right) {
+    }
+
+    constexpr position operator*() const {
+      return current;
+    }
+
+    constexpr position operator[](difference_type n) const {
+      return *(*this + n);
+    }
+
+    constexpr iterator & operator++() {
+      if (++current.x == right) {
+        current.x = left;
+        ++current.y;
+      }
+      return *this;
+    }
+
+    constexpr iterator operator++(int) {
+      auto copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    constexpr iterator & operator--() {
+      if (current.x == left) {
+        current.x = right;
+        --current.y;
+      }
+      --current.x;
+      return *this;
+    }
+
+    constexpr iterator operator--(int) {
+      auto copy = *this;
+      --*this;
+      return copy;
+    }
+
+    // Jumps go through the index of the position, floored so that they
+    // also work above the first row.
+    constexpr iterator & operator+=(difference_type n) {
+      const difference_type width = right - left;
+      const difference_type index = (current.x - left) + n;
+      difference_type rows = index / width;
+      if (index % width < 0)
+        rows--;
+      current.x = left + static_cast<int>(index - rows * width);
+      current.y += static_cast<int>(rows);
+      return *this;
+    }
+
+    constexpr iterator & operator-=(difference_type n) {
+      return *this += -n;
+    }
+
+    friend constexpr iterator operator+(iterator it, difference_type n) {
+      return it += n;
+    }
+
+    friend constexpr iterator operator+(difference_type n, iterator it) {
+      return it += n;
+    }
+
+    friend constexpr iterator operator-(iterator it, difference_type n) {
+      return it -= n;
+    }
+
+    friend constexpr difference_type operator-(const iterator & a, const iterator & b) {
+      return static_cast<difference_type>(a.current.y - b.current.y) * (a.right - a.left) + (a.current.x - b.current.x);
+    }
+
+    friend constexpr bool operator==(const iterator & a, const iterator & b) {
+      return a.current == b.current;
+    }
+
+    friend constexpr std::strong_ordering operator<=>(const iterator & a, const iterator & b) {
+      if (auto order = a.current.y <=> b.current.y; order != 0)
+        return order;
+      return a.current.x <=> b.current.x;
+    }
+
+  private:
+    position current{};
+    int left = 0;
+    int right = 0;
+  };
+
+  constexpr grid_range() = default;
+
+  constexpr grid_range(position top_left, position bottom_right)
+    : top_left(top_left),
+      bottom_right(bottom_right) {
+  }
+
+  constexpr bool empty() const {
+    return top_left.x >= bottom_right.x || top_left.y >= bottom_right.y;
+  }
+
+  constexpr std::size_t size() const {
+    return empty() ? 0 : static_cast<std::size_t>(bottom_right.x - top_left.x) * static_cast<std::size_t>(bottom_right.y - top_left.y);
+  }
+
+  constexpr iterator begin() const {
+    return { top_left, top_left.x, bottom_right.x };
+  }
+
+  // Past the last row, or at the start for an empty rectangle.
+  constexpr iterator end() const {
+    return { empty() ? top_left : position{ top_left.x, bottom_right.y }, top_left.x, bottom_right.x };
+  }
+
+  constexpr auto rows() const {
+    return std::views::iota(top_left.y, empty() ? top_left.y : bottom_right.y) |
+           std::views::transform([left = top_left.x, right = bottom_right.x](int y) {
+             return grid_range({ left, y }, { right, y + 1 });
+           });
+  }
+
+private:
+  position top_left{};
+  position bottom_right{};
+};
+
+static_assert(std::ranges::random_access_range<grid_range> && std::ranges::sized_range<grid_range> &&
+              std::ranges::view<grid_range>);
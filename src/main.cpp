@@ -1,6 +1,308 @@
+#include "archive.hpp"
+#include "batch.hpp"
+#include "constraints.hpp"
+#include "corridors.hpp"
 #include "map.hpp"
+#include "templates.hpp"
+#include "tiled.hpp"
+#include <chrono>
+#include <charconv>
+#include <cstdio>
+#include <exception>
+#include <optional>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+struct options {
+  std::size_t count = 0;
+  std::size_t threads = std::thread::hardware_concurrency();
+  std::uint64_t seed = 0;
+  // Full map size, 0 for the built-in template.
+  std::size_t width = 0;
+  std::size_t height = 0;
+  // Side of the tiles each map is split into, 0 to generate maps whole.
+  std::size_t tile = 0;
+  // Format string of each printed map, see map_encoding, and what follows
+  // every map of a batch. PBM images follow each other without a
+  // separator.
+  std::string_view pattern = "{}";
+  std::string_view separator = "\n";
+  // Template file to generate from, instead of the built-in one.
+  std::string_view template_path;
+  // Archive to write the maps to instead of printing them.
+  std::string_view archive;
+  // Whether the archive stores the corridor graph of every map.
+  bool graphs = false;
+  // Constraints every map must meet, see constraints.hpp. A wall group
+  // limit of 0 is no limit.
+  double min_density = 0;
+  double max_density = 1;
+  std::size_t max_wall_group = 0;
+  bool connected = false;
+  bool no_dead_ends = false;
+  // Whether an option only batches use was given: without --count the
+  // built-in map is printed, and it would be ignored.
+  bool batch_only = false;
+
+  bool constrained() const {
+    return min_density > 0 || max_density < 1 || max_wall_group > 0 || connected || no_dead_ends;
+  }
+};
+
+// Attempts at each map of a constrained batch before giving up.
+constexpr std::size_t max_attempts = 100000;
+
+template<typename T>
+bool parse_number(std::string_view arg, T & value) {
+  auto [end, error] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+  return error == std::errc{} && end == arg.data() + arg.size();
+}
+
+// "<width>x<height>", an even width of at least 8 and a height of at
+// least 4 so that a wall block fits.
+bool parse_size(std::string_view arg, options & opts) {
+  const auto separator = arg.find('x');
+  if (separator == std::string_view::npos)
+    return false;
+  return parse_number(arg.substr(0, separator), opts.width) && parse_number(arg.substr(separator + 1), opts.height) &&
+         opts.width % 2 == 0 && opts.width >= 8 && opts.height >= 4;
+}
+
+// A percentage, stored as a fraction.
+bool parse_density(std::string_view arg, double & density) {
+  double percent = 0;
+  if (!parse_number(arg, percent) || percent < 0 || percent > 100)
+    return false;
+  density = percent / 100;
+  return true;
+}
+
+bool parse_options(int argc, char ** argv, options & opts) {
+  for (int i = 1; i < argc; i++) {
+    const std::string_view arg = argv[i];
+    if (i + 1 >= argc)
+      return false;
+    const std::string_view value = argv[++i];
+    bool valid = false;
+    if (arg == "--size" || arg == "--template" || arg == "--tile" || arg == "--seed")
+      opts.batch_only = true;
+    if (arg == "--count")
+      valid = parse_number(value, opts.count);
+    else if (arg == "--size")
+      valid = parse_size(value, opts);
+    else if (arg == "--tile")
+      valid = parse_number(value, opts.tile) && opts.tile >= 4;
+    else if (arg == "--format") {
+      valid = value == "emoji" || value == "ascii" || value == "pbm";
+      opts.pattern = value == "ascii" ? "{:a}" : value == "pbm" ? "{:p}" : "{}";
+      opts.separator = value == "pbm" ? "" : "\n";
+    } else if (arg == "--template") {
+      opts.template_path = value;
+      valid = !value.empty();
+    } else if (arg == "--archive") {
+      opts.archive = value;
+      valid = !value.empty();
+    } else if (arg == "--graphs") {
+      valid = value == "yes" || value == "no";
+      opts.graphs = value == "yes";
+    } else if (arg == "--min-density")
+      valid = parse_density(value, opts.min_density);
+    else if (arg == "--max-density")
+      valid = parse_density(value, opts.max_density);
+    else if (arg == "--max-wall-group")
+      valid = parse_number(value, opts.max_wall_group) && opts.max_wall_group > 0;
+    else if (arg == "--require") {
+      // A playable map is connected and has no dead ends.
+      valid = value == "connected" || value == "playable";
+      opts.connected = true;
+      opts.no_dead_ends = opts.no_dead_ends || value == "playable";
+    } else if (arg == "--threads")
+      valid = parse_number(value, opts.threads);
+    else if (arg == "--seed" && value == "random") {
+      opts.seed = rng::random_seed();
+      valid = true;
+    } else if (arg == "--seed")
+      valid = parse_number(value, opts.seed);
+    if (!valid)
+      return false;
+  }
+  return true;
+}
+
+// A generated map, with its corridor graph when the archive stores them.
+template<typename Map>
+struct generated_map {
+  Map m;
+  std::optional<corridor_graph> graph;
+};
+
+// The graph is built where the map was generated, on `threads` threads.
+template<typename Map>
+generated_map<Map> with_graph(const options & opts, Map m, std::size_t threads = 1) {
+  std::optional<corridor_graph> graph;
+  if (opts.graphs)
+    graph = build_corridor_graph(map{ m }, threads);
+  return { std::move(m), std::move(graph) };
+}
+
+// Prints the maps, or adds them to the archive when there is one.
+struct output {
+  const options & opts;
+  std::optional<archive::writer> archive;
+
+  template<typename Map>
+  void operator()(const generated_map<Map> & generated) {
+    if (archive)
+      archive->add(generated.m, generated.graph ? &*generated.graph : nullptr);
+    else {
+      fmt::print(fmt::runtime(opts.pattern), generated.m);
+      fmt::print("{}", opts.separator);
+    }
+  }
+};
+
+template<typename Generate>
+void output_batch(const options & opts, output & out, Generate generate) {
+  batch::run(
+    opts.count, opts.threads,
+    [&](std::size_t index) {
+      return with_graph(opts, generate(index));
+    },
+    [&](std::size_t, const auto & generated) {
+      out(generated);
+    });
+}
+
+// The cheap constraints first, they can drop a map mid-generation.
+template<typename HalfMap>
+std::vector<constraint<HalfMap>> make_constraints(const options & opts) {
+  std::vector<constraint<HalfMap>> list;
+  if (opts.max_density < 1)
+    list.emplace_back(constraints::max_density{ opts.max_density });
+  if (opts.max_wall_group > 0)
+    list.emplace_back(constraints::max_wall_group{ opts.max_wall_group });
+  if (opts.min_density > 0)
+    list.emplace_back(constraints::min_density{ opts.min_density });
+  if (opts.connected)
+    list.emplace_back(constraints::connected{});
+  if (opts.no_dead_ends)
+    list.emplace_back(constraints::no_dead_ends{});
+  return list;
+}
+
+// Map `index` of a constrained batch is the first map to meet the
+// constraints among create_random_map(template, seed, index + k * count)
+// for k = 0, 1, ..., so every attempt of the batch has its own stream.
+// The attempts stop early once the batch is stopped, by a map that
+// failed or an error writing the output.
+template<typename HalfMap, typename Convert>
+rejection_stats output_constrained(const options & opts, output & out, const HalfMap & start_template, Convert convert) {
+  using generated = decltype(convert(start_template));
+  rejection_stats totals;
+  batch::run(
+    opts.count, opts.threads,
+    [&](std::size_t index, std::stop_token stop) {
+      rejecting_generator generator(start_template, make_constraints<HalfMap>(opts));
+      std::optional<generated> result;
+      for (std::size_t k = 0; k < max_attempts && !result && !stop.stop_requested(); k++) {
+        if (generator.generate(opts.seed, index + k * opts.count))
+          result.emplace(convert(generator.state()));
+      }
+      return std::pair{ std::move(result), generator.take_stats() };
+    },
+    [&](std::size_t index, const auto & result) {
+      totals += result.second;
+      if (!result.first)
+        throw std::runtime_error(fmt::format("map {} did not meet the constraints in {} attempts", index, max_attempts));
+      out(*result.first);
+    });
+  return totals;
+}
+
+void print_rejections(const rejection_stats & stats) {
+  fmt::print(stderr, "accepted {} of {} attempts\n", stats.accepted, stats.attempts);
+  for (std::size_t i = 0; i < stats.constraints.size(); i++) {
+    const auto & entry = stats.constraints[i];
+    fmt::print(stderr, "  {}: {} aborted, {} rejected ({:.1f}%)\n", entry.name, entry.aborted, entry.rejected,
+               100 * stats.rejection_rate(i));
+  }
+}
+
+// Map `index` of a batch is create_random_map(template, seed, index), so
+// any map of the batch can be regenerated on its own.
+void generate_batch(const options & opts) {
+  const auto start = std::chrono::steady_clock::now();
+  output out{ opts, std::nullopt };
+  if (!opts.archive.empty())
+    out.archive.emplace(std::filesystem::path(opts.archive));
+  std::optional<rejection_stats> rejections;
+  if (opts.constrained() && opts.width == 0 && opts.template_path.empty()) {
+    rejections = output_constrained(opts, out, create_map_template(), [&](const auto & hm) {
+      return with_graph(opts, packed_map{ hm });
+    });
+  } else if (opts.constrained()) {
+    const auto start_template = opts.template_path.empty()
+                                  ? create_empty_template(opts.width / 2, opts.height)
+                                  : load_template(std::filesystem::path(opts.template_path));
+    rejections = output_constrained(opts, out, start_template, [&](const auto & hm) {
+      return with_graph(opts, packed_map{ hm });
+    });
+  } else if (opts.width == 0 && opts.template_path.empty()) {
+    output_batch(opts, out, [&](std::size_t index) {
+      return create_random_map(opts.seed, index);
+    });
+  } else {
+    const auto start_template = opts.template_path.empty()
+                                  ? create_empty_template(opts.width / 2, opts.height)
+                                  : load_template(std::filesystem::path(opts.template_path));
+    if (opts.tile == 0) {
+      output_batch(opts, out, [&](std::size_t index) {
+        return create_random_map(start_template, opts.seed, index);
+      });
+    } else {
+      // The threads go to the tiles of one map at a time.
+      for (std::size_t index = 0; index < opts.count; index++)
+        out(with_graph(opts, tiled::create_random_map(start_template, opts.seed, index, opts.tile, opts.tile, opts.threads),
+                       opts.threads));
+    }
+  }
+  if (out.archive)
+    out.archive->finish();
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  fmt::print(stderr, "generated {} maps from seed {} in {:.3f}s on {} threads ({:.1f} maps/s)\n",
+             opts.count, opts.seed, elapsed.count(), std::max<std::size_t>(opts.threads, 1),
+             static_cast<double>(opts.count) / elapsed.count());
+  if (rejections)
+    print_rejections(*rejections);
+}
+
+} // namespace
+
+int main(int argc, char ** argv) {
+  options opts;
+  if (!parse_options(argc, argv, opts) || (opts.width > 0 && !opts.template_path.empty()) ||
+      (opts.tile > 0 && opts.width == 0 && opts.template_path.empty()) || (opts.tile > 0 && opts.constrained()) ||
+      (opts.count == 0 && (opts.constrained() || opts.batch_only)) || (opts.graphs && opts.archive.empty()) ||
+      (opts.count == 0 && !opts.archive.empty()) || opts.min_density > opts.max_density) {
+    fmt::print(stderr, "usage: {} [--count N] [--threads T] [--seed S|random] [--size WxH | --template FILE] [--tile N] "
+                       "[--format emoji|ascii|pbm | --archive FILE [--graphs yes|no]] [--min-density P] [--max-density P] [--max-wall-group N] "
+                       "[--require connected|playable]\n",
+               argv[0]);
+    return 1;
+  }
+  if (opts.count > 0) {
+    try {
+      generate_batch(opts);
+    } catch (const std::exception & e) {
+      fmt::print(stderr, "{}\n", e.what());
+      return 1;
+    }
+    return 0;
+  }
 
-int main() {
   constexpr map m{ create_random_map() };
-  fmt::print("{}", m);
+  fmt::print(fmt::runtime(opts.pattern), m);
 }
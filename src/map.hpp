@@ -1,98 +1,698 @@
-#include "cartesian_product.hpp"
+#pragma once
 #include "compiletime_random.hpp"
-#include "enumerate.hpp"
+#include "grid.hpp"
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <fmt/format.h>
 #include <functional>
 #include <limits>
 #include <map>
-#include <random>
 #include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
 
 // constexpr Pac-Man Maze Generator
 // inspired by https://github.com/shaunlebron/pacman-mazegen
 
+// The size of a grid, either compile-time constants or, when both are
+// std::dynamic_extent, chosen at runtime.
+template<std::size_t w, std::size_t h>
+struct grid_extent {
+  static constexpr std::size_t width = w;
+  static constexpr std::size_t height = h;
+  static constexpr bool is_dynamic = false;
+
+  bool operator==(const grid_extent &) const = default;
+};
+
+template<>
+struct grid_extent<std::dynamic_extent, std::dynamic_extent> {
+  std::size_t width = 0;
+  std::size_t height = 0;
+  static constexpr bool is_dynamic = true;
+
+  bool operator==(const grid_extent &) const = default;
+};
+
+// Storage for a `width` x `height` grid; the sizes only matter to the
+// runtime-sized grids.
+template<typename Grid>
+constexpr Grid make_grid(std::size_t width, std::size_t height) {
+  if constexpr (std::is_constructible_v<Grid, std::size_t, std::size_t>)
+    return Grid(width, height);
+  else
+    return Grid{};
+}
+
+// Cells are stored in one row-major array: inline for a fixed size, a
+// single allocation for a runtime size.
 template<typename T, std::size_t width, std::size_t height>
-struct board : std::array<std::array<T, width>, height> {
-  using Base = std::array<std::array<T, width>, height>;
+struct board {
+  static constexpr bool is_dynamic = grid_extent<width, height>::is_dynamic;
 
-  using Base::operator[];
+  [[no_unique_address]] grid_extent<width, height> extent;
+  std::conditional_t<is_dynamic, std::vector<T>, std::array<T, width * height>> cells{};
 
-  constexpr T & operator[](std::size_t x, std::size_t y) {
-    return Base::operator[](y)[x];
+  constexpr board() requires(!is_dynamic) = default;
+
+  constexpr board(std::size_t w, std::size_t h) requires is_dynamic
+    : extent{ w, h },
+      cells(w * h) {
   }
 
-  constexpr const T & operator[](std::size_t x, std::size_t y) const {
-    return Base::operator[](y)[x];
+  bool operator==(const board &) const = default;
+
+  constexpr decltype(auto) operator[](std::size_t x, std::size_t y) {
+    return cells[y * extent.width + x];
+  }
+
+  constexpr decltype(auto) operator[](std::size_t x, std::size_t y) const {
+    return cells[y * extent.width + x];
+  }
+
+  constexpr void set(std::size_t x, std::size_t y, T value = T{ true }) {
+    (*this)[x, y] = value;
+  }
+
+  constexpr void clear() {
+    std::ranges::fill(cells, T{});
+  }
+
+  // Rectangle queries, the rectangle must lie inside the board.
+  constexpr bool none(std::size_t x, std::size_t y, std::size_t w, std::size_t h) const {
+    return std::ranges::none_of(cells_of(x, y, w, h), [this](position p) { return bool(at(p)); });
+  }
+
+  constexpr bool all(std::size_t x, std::size_t y, std::size_t w, std::size_t h) const {
+    return std::ranges::all_of(cells_of(x, y, w, h), [this](position p) { return bool(at(p)); });
+  }
+
+private:
+  static constexpr grid_range cells_of(std::size_t x, std::size_t y, std::size_t w, std::size_t h) {
+    return { { static_cast<int>(x), static_cast<int>(y) }, { static_cast<int>(x + w), static_cast<int>(y + h) } };
+  }
+
+  constexpr decltype(auto) at(position p) const {
+    return (*this)[static_cast<std::size_t>(p.x), static_cast<std::size_t>(p.y)];
   }
 };
 
+// One bit per cell, each row stored as a run of 64-bit words so that
+// rectangle queries are a couple of shifts and masks per row instead of
+// one load per cell. Rows are padded to whole words, the bits past
+// `width` are always zero.
 template<std::size_t width, std::size_t height>
+struct bitboard {
+  using word_type = std::uint64_t;
+  static constexpr std::size_t word_bits = 64;
+  static constexpr bool is_dynamic = grid_extent<width, height>::is_dynamic;
+
+  [[no_unique_address]] grid_extent<width, height> extent;
+  std::conditional_t<is_dynamic,
+                     std::vector<word_type>,
+                     std::array<word_type, (width + word_bits - 1) / word_bits * height>>
+    words{};
+
+  constexpr bitboard() requires(!is_dynamic) = default;
+
+  constexpr bitboard(std::size_t w, std::size_t h) requires is_dynamic
+    : extent{ w, h },
+      words((w + word_bits - 1) / word_bits * h) {
+  }
+
+  bool operator==(const bitboard &) const = default;
+
+  constexpr std::size_t words_per_row() const {
+    return (extent.width + word_bits - 1) / word_bits;
+  }
+
+  constexpr const word_type * row(std::size_t y) const {
+    return words.data() + y * words_per_row();
+  }
+
+  constexpr word_type * row(std::size_t y) {
+    return words.data() + y * words_per_row();
+  }
+
+  constexpr bool operator[](std::size_t x, std::size_t y) const {
+    return (row(y)[x / word_bits] >> (x % word_bits)) & 1u;
+  }
+
+  constexpr void set(std::size_t x, std::size_t y, bool value = true) {
+    const word_type bit = word_type{ 1 } << (x % word_bits);
+    if (value)
+      row(y)[x / word_bits] |= bit;
+    else
+      row(y)[x / word_bits] &= ~bit;
+  }
+
+  constexpr void clear() {
+    std::ranges::fill(words, word_type{ 0 });
+  }
+
+  static constexpr word_type mask(std::size_t count) {
+    return count >= word_bits ? ~word_type{ 0 } : (word_type{ 1 } << count) - 1;
+  }
+
+  // The `count` (at most 64) cells of row `y` starting at column `x`,
+  // cell `x` in the lowest bit.
+  constexpr word_type bits(std::size_t x, std::size_t y, std::size_t count) const {
+    const word_type * cells = row(y);
+    const std::size_t index = x / word_bits;
+    const std::size_t offset = x % word_bits;
+    word_type value = cells[index] >> offset;
+    if (offset != 0 && index + 1 < words_per_row())
+      value |= cells[index + 1] << (word_bits - offset);
+    return value & mask(count);
+  }
+
+  // Rectangle queries, the rectangle must lie inside the board and be at
+  // most 64 cells wide.
+  constexpr bool none(std::size_t x, std::size_t y, std::size_t w, std::size_t h) const {
+    for (std::size_t r = y; r < y + h; r++) {
+      if (bits(x, r, w) != 0)
+        return false;
+    }
+    return true;
+  }
+
+  constexpr bool all(std::size_t x, std::size_t y, std::size_t w, std::size_t h) const {
+    for (std::size_t r = y; r < y + h; r++) {
+      if (bits(x, r, w) != mask(w))
+        return false;
+    }
+    return true;
+  }
+};
+
+template<std::size_t width, std::size_t height, typename Walls>
 struct half_map;
 
+// A map is twice as wide as the half map it mirrors.
+constexpr std::size_t mirrored_width(std::size_t width) {
+  return width == std::dynamic_extent ? width : width * 2;
+}
+
+constexpr std::size_t half_width(std::size_t width) {
+  return width == std::dynamic_extent ? width : width / 2;
+}
+
+// The bits of `word` in reverse order.
+constexpr std::uint64_t reverse_bits(std::uint64_t word) {
+  word = ((word >> 1) & 0x5555555555555555u) | ((word & 0x5555555555555555u) << 1);
+  word = ((word >> 2) & 0x3333333333333333u) | ((word & 0x3333333333333333u) << 2);
+  word = ((word >> 4) & 0x0f0f0f0f0f0f0f0fu) | ((word & 0x0f0f0f0f0f0f0f0fu) << 4);
+  return std::byteswap(word);
+}
+
+// Reverses the bit string `in`, word 0 holding the lowest bits, into
+// `out` of the same size. Two words at a time with SSSE3 at runtime when
+// the build enables it: a nibble lookup through PSHUFB reverses the bits
+// of each byte, a second shuffle the order of the bytes.
+constexpr void reverse_bits(std::span<const std::uint64_t> in, std::span<std::uint64_t> out) {
+  const std::size_t n = in.size();
+  std::size_t i = 0;
+#if defined(__SSSE3__)
+  if (!std::is_constant_evaluated()) {
+    const __m128i low_nibbles = _mm_set1_epi8(0x0f);
+    const __m128i reversed_nibbles = _mm_setr_epi8(0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe, 0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7, 0xf);
+    const __m128i reversed_bytes = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    for (; i + 2 <= n; i += 2) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&in[n - 2 - i]));
+      const __m128i low = _mm_shuffle_epi8(reversed_nibbles, _mm_and_si128(v, low_nibbles));
+      const __m128i high = _mm_shuffle_epi8(reversed_nibbles, _mm_and_si128(_mm_srli_epi16(v, 4), low_nibbles));
+      const __m128i bytes = _mm_or_si128(_mm_slli_epi16(low, 4), high);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(&out[i]), _mm_shuffle_epi8(bytes, reversed_bytes));
+    }
+  }
+#endif
+  for (; i < n; i++)
+    out[i] = reverse_bits(in[n - 1 - i]);
+}
+
+// ORs the bit string `in` into `out` moved up by `shift` bits, or down
+// when `shift` is negative. Bits moved past either end are dropped.
+constexpr void or_shifted(std::span<const std::uint64_t> in, std::span<std::uint64_t> out, std::ptrdiff_t shift) {
+  for (std::size_t i = 0; i < in.size(); i++) {
+    const std::ptrdiff_t low = static_cast<std::ptrdiff_t>(i * 64) + shift;
+    const std::ptrdiff_t word = low >= 0 ? low / 64 : (low - 63) / 64;
+    const auto offset = static_cast<unsigned>(low - word * 64);
+    if (word >= 0 && static_cast<std::size_t>(word) < out.size())
+      out[static_cast<std::size_t>(word)] |= in[i] << offset;
+    if (offset != 0 && word + 1 >= 0 && static_cast<std::size_t>(word + 1) < out.size())
+      out[static_cast<std::size_t>(word + 1)] |= in[i] >> (64 - offset);
+  }
+}
+
+// A generated map in as few bits as its half map needs, for keeping many
+// of them around: one bit per cell of the half map, rows packed back to
+// back, the other half mirrored on access. Trivially copyable for a fixed
+// size. This is what create_random_map returns, so a map can only be
+// mirrored from a half map once.
 template<std::size_t width, std::size_t height>
-struct map {
-  constexpr map(half_map<width / 2, height> hm) {
-    for (const auto & [index, row] : polyfill::enumerate(hm.walls)) {
-      std::ranges::copy(row, std::ranges::begin(walls[index]));
-      std::ranges::copy(row, std::ranges::rbegin(walls[index]));
+struct packed_map {
+  static constexpr bool is_dynamic = grid_extent<width, height>::is_dynamic;
+
+  [[no_unique_address]] grid_extent<width, height> extent;
+  std::conditional_t<is_dynamic, std::vector<std::uint64_t>, std::array<std::uint64_t, (width / 2 * height + 63) / 64>>
+    bits{};
+
+  constexpr packed_map() requires(!is_dynamic) = default;
+
+  template<typename Walls>
+  constexpr explicit packed_map(const half_map<half_width(width), height, Walls> & hm) {
+    if constexpr (is_dynamic) {
+      extent = { hm.extent.width * 2, hm.extent.height };
+      bits.resize((half() * extent.height + 63) / 64);
+    }
+    for (std::size_t y = 0; y < extent.height; y++) {
+      if constexpr (std::is_same_v<Walls, bitboard<half_width(width), height>>) {
+        or_shifted({ hm.walls.row(y), hm.walls.words_per_row() }, bits, static_cast<std::ptrdiff_t>(y * half()));
+      } else {
+        for (std::size_t x = 0; x < half(); x++) {
+          if (hm.walls[x, y])
+            bits[(y * half() + x) / 64] |= std::uint64_t{ 1 } << ((y * half() + x) % 64);
+        }
+      }
     }
   }
-  board<bool, width, height> walls;
+
+  bool operator==(const packed_map &) const = default;
+
+  constexpr std::size_t half() const {
+    return extent.width / 2;
+  }
+
+  constexpr bool operator[](std::size_t x, std::size_t y) const {
+    if (x >= half())
+      x = extent.width - 1 - x;
+    const std::size_t i = y * half() + x;
+    return (bits[i / 64] >> (i % 64)) & 1u;
+  }
+
+  // Row `y` of the half map into `out`, laid out as a bitboard row: cell
+  // `x` in bit x % 64 of word x / 64, the padding zero.
+  constexpr void half_row(std::size_t y, std::span<std::uint64_t> out) const {
+    const std::size_t first = y * half();
+    const std::size_t begin = first / 64;
+    const std::size_t end = (first + half() + 63) / 64;
+    std::ranges::fill(out, std::uint64_t{ 0 });
+    or_shifted(std::span<const std::uint64_t>(bits).subspan(begin, end - begin), out, -static_cast<std::ptrdiff_t>(first % 64));
+    if (half() % 64 != 0)
+      out.back() &= (std::uint64_t{ 1 } << (half() % 64)) - 1;
+  }
 };
 
+template<std::size_t width, std::size_t height, typename Walls>
+packed_map(half_map<width, height, Walls>) -> packed_map<mirrored_width(width), height>;
+
 template<std::size_t width, std::size_t height>
-map(half_map<width, height>) -> map<width * 2, height>;
+struct map {
+  template<typename Walls>
+  constexpr map(const half_map<half_width(width), height, Walls> & hm)
+    : walls(make_grid<bitboard<width, height>>(hm.extent.width * 2, hm.extent.height)) {
+    if constexpr (std::is_same_v<Walls, bitboard<half_width(width), height>>) {
+      row_buffer reversed(hm.walls.words_per_row());
+      for (std::size_t y = 0; y < walls.extent.height; y++)
+        mirror_row(y, { hm.walls.row(y), hm.walls.words_per_row() }, reversed.words);
+    } else {
+      const std::size_t half = hm.extent.width;
+      for (std::size_t y = 0; y < walls.extent.height; y++) {
+        for (std::size_t x = 0; x < half; x++) {
+          walls.set(x, y, hm.walls[x, y]);
+          walls.set(2 * half - 1 - x, y, hm.walls[x, y]);
+        }
+      }
+    }
+  }
+
+  constexpr map(const packed_map<width, height> & packed)
+    : walls(make_grid<bitboard<width, height>>(packed.extent.width, packed.extent.height)) {
+    const std::size_t half_words = (packed.half() + 63) / 64;
+    row_buffer row(half_words);
+    row_buffer reversed(half_words);
+    for (std::size_t y = 0; y < walls.extent.height; y++) {
+      packed.half_row(y, row.words);
+      mirror_row(y, row.words, reversed.words);
+    }
+  }
+
+  bitboard<width, height> walls;
+
+private:
+  // Scratch space for a row of `size` words, inline up to 1024 cells.
+  struct row_buffer {
+    std::array<std::uint64_t, 16> inline_words{};
+    std::vector<std::uint64_t> heap_words;
+    std::span<std::uint64_t> words;
 
-struct position {
-  int x, y;
-  bool operator==(const position &) const = default;
+    constexpr explicit row_buffer(std::size_t size)
+      : words(inline_words.data(), size) {
+      if (size > inline_words.size()) {
+        heap_words.resize(size);
+        words = heap_words;
+      }
+    }
+  };
+
+  // Row `y` from the same row of the half map: the left half is its words
+  // as they are and the right half the same words bit-reversed. The
+  // reversed row ends with the padding of the half row, which the shift
+  // drops.
+  constexpr void mirror_row(std::size_t y, std::span<const std::uint64_t> half_row, std::span<std::uint64_t> reversed) {
+    const std::span<std::uint64_t> out(walls.row(y), walls.words_per_row());
+    const auto shift = static_cast<std::ptrdiff_t>(walls.extent.width) - static_cast<std::ptrdiff_t>(half_row.size() * 64);
+    std::ranges::copy(half_row, out.begin());
+    reverse_bits(half_row, reversed);
+    or_shifted(reversed, out, shift);
+  }
 };
 
+template<std::size_t width, std::size_t height, typename Walls>
+map(half_map<width, height, Walls>) -> map<mirrored_width(width), height>;
+
 template<std::size_t width, std::size_t height>
-struct half_map {
-  constexpr half_map(std::string_view str) {
-    auto view =
-      std::views::filter(str,
-                         [](char c) { return c == '|' || c == '.'; }) |
-      std::views::transform([](char c) { return c == '|' ? 1 : 0; });
-    for (std::size_t y = 0; y < height; y++) {
-      std::ranges::copy(
-        view | std::views::drop(y * width) | std::views::take(width),
-        std::begin(walls[y]));
+map(packed_map<width, height>) -> map<width, height>;
+
+using dynamic_map = map<std::dynamic_extent, std::dynamic_extent>;
+
+// Connections between free positions, indexed by source position.
+// add_connection can only link a source to 6 destinations in each of the
+// 4 directions, so each source stores which of these 24 links exist as a
+// bit mask: no allocation per node, and the table is updated in place.
+template<std::size_t width, std::size_t height>
+struct connection_table {
+  static constexpr std::array<position, 4> directions = { { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } } };
+  static constexpr int links_per_direction = 6;
+  static constexpr int link_count = 4 * links_per_direction;
+
+  // Destination of `link` relative to its source, in the order
+  // add_connection produces them.
+  static constexpr position offset(int link) {
+    const auto [dx, dy] = directions[static_cast<std::size_t>(link / links_per_direction)];
+    constexpr std::array<position, links_per_direction> steps = { { { 1, 0 }, { 2, 0 }, { 1, -1 }, { 1, 1 }, { 2, -1 }, { 2, 1 } } };
+    const auto [forward, side] = steps[static_cast<std::size_t>(link % links_per_direction)];
+    return { forward * dx + side * dy, forward * dy + side * dx };
+  }
+
+  static constexpr int link(position direction, int index) {
+    const auto it = std::ranges::find(directions, direction);
+    return static_cast<int>(it - std::ranges::begin(directions)) * links_per_direction + index;
+  }
+
+  // The links to probe for the sources of a destination, ordered so that
+  // the sources come out in scan order (columns first) and, for a single
+  // source, in the order its links were added.
+  static constexpr std::array<int, link_count> lookup_order = [] {
+    std::array<int, link_count> order;
+    std::ranges::copy(std::views::iota(0, link_count), order.begin());
+    std::ranges::sort(order, {}, [](int link) {
+      return std::tuple{ -offset(link).x, -offset(link).y, link };
+    });
+    return order;
+  }();
+
+  board<std::uint32_t, width, height> links;
+
+  constexpr connection_table() requires(!board<std::uint32_t, width, height>::is_dynamic) = default;
+
+  constexpr connection_table(std::size_t w, std::size_t h) requires board<std::uint32_t, width, height>::is_dynamic
+    : links(w, h) {
+  }
+
+  bool operator==(const connection_table &) const = default;
+
+  constexpr void clear() {
+    links.clear();
+  }
+
+  constexpr void clear(position source) {
+    links[static_cast<std::size_t>(source.x), static_cast<std::size_t>(source.y)] = 0;
+  }
+
+  constexpr void add(position source, int link) {
+    links[static_cast<std::size_t>(source.x), static_cast<std::size_t>(source.y)] |= std::uint32_t{ 1 } << link;
+  }
+
+  constexpr bool has(position source, int link) const {
+    if (source.x < 0 || static_cast<std::size_t>(source.x) >= links.extent.width || source.y < 0 || static_cast<std::size_t>(source.y) >= links.extent.height)
+      return false;
+    return (links[static_cast<std::size_t>(source.x), static_cast<std::size_t>(source.y)] >> link) & 1u;
+  }
+
+  // The position that would reach `dest` through `link`.
+  static constexpr position source(position dest, int link) {
+    return { dest.x - offset(link).x, dest.y - offset(link).y };
+  }
+
+  constexpr auto sources(position dest) const {
+    auto from = [dest](int link) {
+      return source(dest, link);
+    };
+    return lookup_order | std::views::filter([this, from](int link) { return has(from(link), link); }) | std::views::transform(from);
+  }
+};
+
+// A set of positions in scan order (x, then y) on a grid `height` cells
+// tall, with removal and lookup of the k-th position in O(log n) through
+// a Fenwick tree over the cells. Replaces a sorted vector, whose erase
+// made generating large maps quadratic.
+struct ranked_positions {
+  std::size_t height = 0;
+  std::size_t count = 0;
+  std::vector<std::uint32_t> tree;
+
+  bool operator==(const ranked_positions &) const = default;
+
+  // The positions p of a `width` x `height` grid with `contains(p)`.
+  template<typename Predicate>
+  constexpr void assign(std::size_t width, std::size_t h, Predicate contains) {
+    height = h;
+    count = 0;
+    tree.assign(width * height + 1, 0);
+    for (std::size_t i = 1; i < tree.size(); i++) {
+      if (contains(at(i - 1))) {
+        tree[i] += 1;
+        count++;
+      }
+      const std::size_t parent = i + lowest_bit(i);
+      if (parent < tree.size())
+        tree[parent] += tree[i];
     }
   }
 
-  std::vector<position> free_positions;
-  std::vector<std::tuple<position, std::vector<position>>> connections;
-  board<bool, width, height> walls;
+  constexpr std::size_t size() const {
+    return count;
+  }
+
+  constexpr bool empty() const {
+    return count == 0;
+  }
+
+  // Only positions in the set can be erased.
+  constexpr void erase(position p) {
+    for (std::size_t i = index(p) + 1; i < tree.size(); i += lowest_bit(i))
+      tree[i]--;
+    count--;
+  }
 
-  rng::PCG pcg = [](int count = 30) {
-    rng::PCG pcg;
-    while (count > 0) {
-      pcg();
-      --count;
+  constexpr position operator[](std::size_t rank) const {
+    std::size_t i = 0;
+    for (std::size_t step = std::bit_floor(tree.size() - 1); step != 0; step /= 2) {
+      if (i + step < tree.size() && tree[i + step] <= rank) {
+        i += step;
+        rank -= tree[i];
+      }
     }
-    return pcg;
-  }();
+    return at(i);
+  }
 
-  auto get_random_number_runtime() {
-    static std::random_device rd;
-    return rd();
+private:
+  static constexpr std::size_t lowest_bit(std::size_t i) {
+    return i & (~i + 1);
   }
 
-  constexpr auto get_random() {
-    if (std::is_constant_evaluated()) {
-      return pcg();
-    } else {
-      return get_random_number_runtime();
+  constexpr std::size_t index(position p) const {
+    return static_cast<std::size_t>(p.x) * height + static_cast<std::size_t>(p.y);
+  }
+
+  constexpr position at(std::size_t i) const {
+    return { static_cast<int>(i / height), static_cast<int>(i % height) };
+  }
+};
+
+// Disjoint sets over the cells of a grid, by index, with union by size,
+// which keeps the trees O(log n) deep for lookups, and path halving on
+// merges. Cells start outside every set.
+struct disjoint_sets {
+  static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+  std::vector<std::uint32_t> parent;
+  std::vector<std::uint32_t> sizes;
+  // Sets, cells in any set, and the size of the largest set.
+  std::size_t count = 0;
+  std::size_t members = 0;
+  std::size_t largest = 0;
+
+  constexpr void reset(std::size_t cells) {
+    parent.assign(cells, none);
+    sizes.assign(cells, 0);
+    count = 0;
+    members = 0;
+    largest = 0;
+  }
+
+  constexpr bool contains(std::size_t cell) const {
+    return parent[cell] != none;
+  }
+
+  constexpr void add(std::size_t cell) {
+    parent[cell] = static_cast<std::uint32_t>(cell);
+    sizes[cell] = 1;
+    count++;
+    members++;
+    largest = std::max<std::size_t>(largest, 1);
+  }
+
+  // The representative of the set of `cell`, which must be in a set.
+  constexpr std::uint32_t find(std::size_t cell) const {
+    auto i = static_cast<std::uint32_t>(cell);
+    while (parent[i] != i)
+      i = parent[i];
+    return i;
+  }
+
+  constexpr void merge(std::size_t a, std::size_t b) {
+    auto root_a = compress(a);
+    auto root_b = compress(b);
+    if (root_a == root_b)
+      return;
+    if (sizes[root_a] < sizes[root_b])
+      std::swap(root_a, root_b);
+    parent[root_b] = root_a;
+    sizes[root_a] += sizes[root_b];
+    count--;
+    largest = std::max<std::size_t>(largest, sizes[root_a]);
+  }
+
+  constexpr std::size_t size_of(std::size_t cell) const {
+    return sizes[find(cell)];
+  }
+
+private:
+  constexpr std::uint32_t compress(std::size_t cell) {
+    auto i = static_cast<std::uint32_t>(cell);
+    while (parent[i] != i) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
     }
+    return i;
+  }
+};
+
+// `Walls` selects the wall storage: `bitboard` (the default) or the
+// byte-per-cell `board<bool, width, height>`. With std::dynamic_extent
+// for both sizes the map is sized at runtime, every grid then lives in a
+// single heap allocation and the generation itself is unchanged.
+template<std::size_t width, std::size_t height, typename Walls = bitboard<width, height>>
+struct half_map {
+  static constexpr bool is_dynamic = grid_extent<width, height>::is_dynamic;
+
+  // A map without walls.
+  constexpr half_map() requires(!is_dynamic) = default;
+
+  constexpr half_map(std::size_t w, std::size_t h) requires is_dynamic
+    : extent{ w, h },
+      free_cells(w, h),
+      connections(w, h),
+      walls(make_grid<Walls>(w, h)),
+      visited_marks(w, h) {
+  }
+
+  constexpr half_map(std::string_view str) requires(!is_dynamic) {
+    parse(str);
+  }
+
+  constexpr half_map(std::size_t w, std::size_t h, std::string_view str) requires is_dynamic
+    : half_map(w, h) {
+    parse(str);
+  }
+
+  // Fills the walls from `str` in a single pass: '|' is a wall, '.' is
+  // free, every other character is skipped. There must be exactly one
+  // cell per position, row by row.
+  constexpr void parse(std::string_view str) {
+    const std::size_t cells = extent.width * extent.height;
+    std::size_t cell = 0;
+    for (const char c : str) {
+      if (c != '|' && c != '.')
+        continue;
+      if (cell == cells)
+        throw std::invalid_argument("template has more cells than the map");
+      walls.set(cell % extent.width, cell / extent.width, c == '|');
+      cell++;
+    }
+    if (cell != cells)
+      throw std::invalid_argument("template has fewer cells than the map");
+  }
+
+  [[no_unique_address]] grid_extent<width, height> extent;
+  // free_positions is kept in scan order for sampling, free_cells holds
+  // the same set for constant time membership tests.
+  ranked_positions free_positions;
+  bitboard<width, height> free_cells;
+  connection_table<width, height> connections;
+  Walls walls;
+
+  // Wall blocks added since free_positions and connections were last
+  // brought up to date, see update_free_positions_and_connections().
+  std::vector<position> pending_blocks;
+  bool collected = false;
+
+  // The wall cells grouped by 4-connectivity inside the half map, kept up
+  // to date by add_wall_tile once the map is collected.
+  disjoint_sets wall_groups;
+
+  // Scratch state of expand_wall. A cell was visited by the current walk
+  // when its mark equals `expansion`, so starting a walk is an increment
+  // rather than a clear of the whole board.
+  struct expansion_frame {
+    position p;
+    int next;
+  };
+  board<std::uint32_t, width, height> visited_marks;
+  std::uint32_t expansion = 0;
+  std::vector<expansion_frame> expansion_stack;
+
+  rng::PCG pcg = rng::PCG{}.jumped(30);
+
+  // All draws come from `pcg`, at compile time and at runtime, so a map
+  // is fully determined by its seed and stream. Without a call to seed()
+  // the sequence is fixed by the build time; pass rng::random_seed() to
+  // get a different map on every run.
+  constexpr void seed(std::uint64_t value, std::uint64_t stream = 0) {
+    pcg = rng::PCG(value, stream);
+  }
+
+  constexpr auto get_random() {
+    return pcg();
   }
 
   constexpr bool is_valid(position p) const {
-    return p.x >= 0 && static_cast<std::size_t>(p.x) < width && p.y >= 0 && static_cast<std::size_t>(p.y) < height;
+    return p.x >= 0 && static_cast<std::size_t>(p.x) < extent.width && p.y >= 0 && static_cast<std::size_t>(p.y) < extent.height;
   }
 
   constexpr bool is_empty(position p) const {
@@ -106,63 +706,49 @@ struct half_map {
   constexpr bool can_fit_new_block(position p) const {
     if (!is_valid(p) || !is_valid({ p.x + 3, p.y + 3 }))
       return false;
-
-    auto view = create_positions({ p.x, p.y }, { p.x + 4, p.y + 4 });
-    auto predicate = [this](const auto & pos) {
-      return is_empty(pos);
-    };
-    return std::ranges::all_of(view, predicate);
+    return walls.none(static_cast<std::size_t>(p.x), static_cast<std::size_t>(p.y), 4, 4);
   }
 
   constexpr bool is_wall_block_filled(position p) const {
-    auto view = polyfill::product(
-                  std::views::iota(1, 3),
-                  std::views::iota(1, 3)) |
-                std::views::transform([&](const auto & tuple) {
-                  return position{ p.x + std::get<0>(tuple), p.y + std::get<1>(tuple) };
-                });
-    return std::ranges::all_of(view, std::bind_front(&half_map::is_wall, this));
+    if (!is_valid({ p.x + 1, p.y + 1 }) || !is_valid({ p.x + 2, p.y + 2 }))
+      return false;
+    return walls.all(static_cast<std::size_t>(p.x + 1), static_cast<std::size_t>(p.y + 1), 2, 2);
   }
 
-  constexpr auto create_positions(position top_left, position bottom_right) const {
-    return polyfill::product(
-             std::views::iota(top_left.x, bottom_right.x),
-             std::views::iota(top_left.y, bottom_right.y)) |
-           std::views::transform(&std::make_from_tuple<position, std::tuple<int, int>>);
+  constexpr grid_range create_positions(position top_left, position bottom_right) const {
+    return { top_left, bottom_right };
   }
 
-  constexpr auto all_positions() const {
-    return create_positions({ 0uz, 0uz }, { width, height });
+  constexpr grid_range all_positions() const {
+    return create_positions({ 0, 0 }, { static_cast<int>(extent.width), static_cast<int>(extent.height) });
   }
 
   constexpr void collect_valid_starting_positions() {
-    free_positions.clear();
-    free_positions.reserve(width * height);
+    free_cells.clear();
 
     auto predicate = [this](const auto & pos) {
       return can_fit_new_block(pos);
     };
     auto view = all_positions() | std::views::filter(predicate);
 
-    std::ranges::copy(view, std::back_inserter(free_positions));
+    for (const auto & pos : view)
+      free_cells.set(static_cast<std::size_t>(pos.x), static_cast<std::size_t>(pos.y));
+    free_positions.assign(extent.width, extent.height, [this](const position & pos) {
+      return has_free_position(pos);
+    });
   }
 
   constexpr bool has_free_position(position pos) const {
-    return std::ranges::find(free_positions, pos) != std::ranges::end(free_positions);
+    return is_valid(pos) && free_cells[static_cast<std::size_t>(pos.x), static_cast<std::size_t>(pos.y)];
   }
 
   constexpr void add_connection(position pos, int dx, int dy) {
     if (!has_free_position(pos))
       return;
-    auto connect = [&](position dest) {
+    auto connect = [&](int index, position dest) {
       if (!has_free_position(dest))
         return;
-      auto it = std::ranges::find_if(connections, [&](const auto & tuple) {
-        return std::get<0>(tuple) == dest;
-      });
-      if (it == std::ranges::end(connections))
-        it = connections.insert(it, std::tuple{ dest, std::vector<position>{} });
-      std::get<1>(*it).push_back(pos);
+      connections.add(pos, connections.link({ dx, dy }, index));
     };
 
     // A - add_connection(pos, dx =  1, dy =  0);
@@ -178,27 +764,20 @@ struct half_map {
     //     |     |     |     |     |     |
 
     auto [x, y] = pos;
-    connect({ x + dx, y + dy });
-    connect({ x + 2 * dx, y + 2 * dy });
+    connect(0, { x + dx, y + dy });
+    connect(1, { x + 2 * dx, y + 2 * dy });
 
     if (!has_free_position({ x - dy, y - dx }))
-      connect({ x + dx - dy, y + dy - dx });
+      connect(2, { x + dx - dy, y + dy - dx });
     if (!has_free_position({ x + dy, y + dx }))
-      connect({ x + dx + dy, y + dy + dx });
+      connect(3, { x + dx + dy, y + dy + dx });
     if (!has_free_position({ x + dx - dy, y + dy - dx }))
-      connect({ x + 2 * dx - dy, y + 2 * dy - dx });
+      connect(4, { x + 2 * dx - dy, y + 2 * dy - dx });
     if (!has_free_position({ x + dx + dy, y + dy + dx }))
-      connect({ x + 2 * dx + dy, y + 2 * dy + dx });
+      connect(5, { x + 2 * dx + dy, y + 2 * dy + dx });
   }
 
-  constexpr void collect_connections() {
-    connections.clear();
-    connections.reserve(width * height);
-    auto predicate = [this](const auto & pos) {
-      return has_free_position(pos);
-    };
-    auto view = all_positions() | std::views::filter(predicate);
-
+  constexpr void add_connections(const position & pos) {
     //     |  c  |  c |  c |  c |
     //   a | x,y |    |    |    | b |
     //   a |     |    |    |    | b |
@@ -207,25 +786,177 @@ struct half_map {
     //     |  d  |  d |  d |  d |
 
     auto four = std::views::iota(0, 4);
+    if (std::ranges::any_of(four, [&](auto i) { return is_wall({ pos.x - 1, pos.y + i }); })) {
+      add_connection(pos, 1, 0);
+    }
+    if (std::ranges::any_of(four, [&](auto i) { return is_wall({ pos.x + 4, pos.y + i }); })) {
+      add_connection(pos, -1, 0);
+    }
+    if (std::ranges::any_of(four, [&](auto i) { return is_wall({ pos.x + i, pos.y - 1 }); })) {
+      add_connection(pos, 0, 1);
+    }
+    if (std::ranges::any_of(four, [&](auto i) { return is_wall({ pos.x + i, pos.y + 4 }); })) {
+      add_connection(pos, 0, -1);
+    }
+  }
+
+  constexpr void collect_connections() {
+    connections.clear();
+    auto predicate = [this](const auto & pos) {
+      return has_free_position(pos);
+    };
+    auto view = all_positions() | std::views::filter(predicate);
+
     for (const auto & pos : view) {
-      if (std::ranges::any_of(four, [&](auto i) { return is_wall({ pos.x - 1, pos.y + i }); })) {
-        add_connection(pos, 1, 0);
-      }
-      if (std::ranges::any_of(four, [&](auto i) { return is_wall({ pos.x + 4, pos.y + i }); })) {
-        add_connection(pos, -1, 0);
+      add_connections(pos);
+    }
+  }
+
+  constexpr std::size_t cell_index(position p) const {
+    return static_cast<std::size_t>(p.y) * extent.width + static_cast<std::size_t>(p.x);
+  }
+
+  // Joins the wall at `p` with the walls left of and above it, or on all
+  // four sides for a new wall.
+  constexpr void join_wall_group(position p, bool all_sides) {
+    const std::size_t cell = cell_index(p);
+    wall_groups.add(cell);
+    for (const auto [dx, dy] : { position{ -1, 0 }, position{ 0, -1 }, position{ 1, 0 }, position{ 0, 1 } }) {
+      if (!all_sides && (dx > 0 || dy > 0))
+        break;
+      const position neighbour{ p.x + dx, p.y + dy };
+      if (is_wall(neighbour))
+        wall_groups.merge(cell, cell_index(neighbour));
+    }
+  }
+
+  constexpr void collect_wall_groups() {
+    wall_groups.reset(extent.width * extent.height);
+    for (std::size_t y = 0; y < extent.height; y++) {
+      for (std::size_t x = 0; x < extent.width; x++) {
+        if (walls[x, y])
+          join_wall_group({ static_cast<int>(x), static_cast<int>(y) }, false);
       }
-      if (std::ranges::any_of(four, [&](auto i) { return is_wall({ pos.x + i, pos.y - 1 }); })) {
-        add_connection(pos, 0, 1);
+    }
+  }
+
+  // The wall group of `p`, an id shared by every wall cell connected to
+  // it, or disjoint_sets::none if `p` is not a wall. Only valid once the
+  // map is collected, as by add_wall.
+  constexpr std::uint32_t wall_group(position p) const {
+    return is_wall(p) ? wall_groups.find(cell_index(p)) : disjoint_sets::none;
+  }
+
+  constexpr std::size_t wall_group_size(position p) const {
+    return is_wall(p) ? wall_groups.size_of(cell_index(p)) : 0;
+  }
+
+  constexpr std::size_t wall_group_count() const {
+    return wall_groups.count;
+  }
+
+  constexpr std::size_t largest_wall_group() const {
+    return wall_groups.largest;
+  }
+
+  constexpr std::size_t wall_cell_count() const {
+    return wall_groups.members;
+  }
+
+  // Calls `f` with every position within `reach` of a pending wall block.
+  // A block at p fills the cells p + 1 and p + 2, so `reach = 2` covers
+  // every position whose 4x4 area overlaps it. Positions near several
+  // blocks are visited more than once.
+  template<typename F>
+  constexpr void for_each_pending_position(int reach, F f) const {
+    const int last_x = static_cast<int>(extent.width) - 1;
+    const int last_y = static_cast<int>(extent.height) - 1;
+    for (const auto & block : pending_blocks) {
+      for (int y = std::max(block.y - reach, 0); y <= std::min(block.y + reach, last_y); y++) {
+        for (int x = std::max(block.x - reach, 0); x <= std::min(block.x + reach, last_x); x++)
+          f(position{ x, y });
       }
-      if (std::ranges::any_of(four, [&](auto i) { return is_wall({ pos.x + i, pos.y + 4 }); })) {
-        add_connection(pos, 0, -1);
+    }
+  }
+
+  // New walls only ever remove free positions, and only near the blocks.
+  constexpr void update_valid_starting_positions() {
+    for_each_pending_position(2, [&](const position & pos) {
+      if (has_free_position(pos) && !can_fit_new_block(pos)) {
+        free_cells.set(static_cast<std::size_t>(pos.x), static_cast<std::size_t>(pos.y), false);
+        free_positions.erase(pos);
       }
+    });
+  }
+
+  // The connections of a position depend on the free positions up to two
+  // cells away and on the walls right around its 4x4 area, so only the
+  // positions within 4 cells of a new block need to be reconnected.
+  constexpr void update_connections() {
+    for_each_pending_position(4, [&](const position & pos) {
+      connections.clear(pos);
+      if (has_free_position(pos))
+        add_connections(pos);
+    });
+  }
+
+  constexpr void update_free_positions_and_connections() {
+    if (!collected) {
+      collect_valid_starting_positions();
+      collect_connections();
+      collect_wall_groups();
+      collected = true;
+    } else if (!pending_blocks.empty()) {
+      update_valid_starting_positions();
+      update_connections();
+    }
+    pending_blocks.clear();
+#ifdef MAZE_BUILDER_VERIFY_INCREMENTAL
+    verify_incremental_update();
+#endif
+  }
+
+  // Debug check, compares the incrementally maintained state against a
+  // full rescan.
+  constexpr void verify_incremental_update() const {
+    half_map rescan = *this;
+    rescan.collect_valid_starting_positions();
+    rescan.collect_connections();
+    if (rescan.free_positions != free_positions || rescan.free_cells != free_cells)
+      throw std::logic_error("incremental update of free_positions diverged from a full rescan");
+    if (rescan.connections != connections)
+      throw std::logic_error("incremental update of connections diverged from a full rescan");
+    rescan.collect_wall_groups();
+    bool same_groups = rescan.wall_group_count() == wall_group_count() &&
+                       rescan.largest_wall_group() == largest_wall_group() &&
+                       rescan.wall_cell_count() == wall_cell_count();
+    for (const auto & pos : all_positions()) {
+      same_groups = same_groups && rescan.wall_group_size(pos) == wall_group_size(pos);
     }
+    if (!same_groups)
+      throw std::logic_error("incremental update of wall_groups diverged from a full rescan");
+  }
+
+  constexpr void begin_expansion() {
+    if (++expansion == 0) {
+      visited_marks.clear();
+      expansion = 1;
+    }
+  }
+
+  constexpr bool is_visited(position p) const {
+    return visited_marks[static_cast<std::size_t>(p.x), static_cast<std::size_t>(p.y)] == expansion;
+  }
+
+  constexpr void mark_visited(position p) {
+    visited_marks.set(static_cast<std::size_t>(p.x), static_cast<std::size_t>(p.y), expansion);
   }
 
   constexpr void add_wall_tile(const position & p) {
-    if (is_valid(p)) {
-      walls[static_cast<std::size_t>(p.x), static_cast<std::size_t>(p.y)] = true;
+    if (is_valid(p) && !is_wall(p)) {
+      walls.set(static_cast<std::size_t>(p.x), static_cast<std::size_t>(p.y));
+      if (collected)
+        join_wall_group(p, true);
     }
   }
 
@@ -234,37 +965,45 @@ struct half_map {
     add_wall_tile({ p.x + 2, p.y + 1 });
     add_wall_tile({ p.x + 1, p.y + 2 });
     add_wall_tile({ p.x + 2, p.y + 2 });
+    pending_blocks.push_back(p);
   }
 
-  constexpr int expand_wall(std::vector<position> & visited, const position & p) {
-    if (std::ranges::find(visited, p) == std::ranges::end(visited))
-      return 0;
-    visited.push_back(p);
-    auto it = std::ranges::find_if(connections, [&](const auto & tuple) {
-      return std::get<0>(tuple) == p;
-    });
-    if (it == std::ranges::end(connections))
-      return 0;
+  // Fills the blocks of every position connected to `start`, directly or
+  // through other connected positions, and returns how many were not
+  // filled yet. A depth-first walk in the order of connections.sources(),
+  // on an explicit stack so that long chains on large maps cannot
+  // overflow the call stack.
+  constexpr int expand_wall(const position & start) {
+    begin_expansion();
+    mark_visited(start);
+    expansion_stack.clear();
+    expansion_stack.push_back({ start, 0 });
 
     int count = 0;
-    for (auto && pos : std::get<1>(*it)) {
+    while (!expansion_stack.empty()) {
+      auto & [p, next] = expansion_stack.back();
+      if (next == connection_table<width, height>::link_count) {
+        expansion_stack.pop_back();
+        continue;
+      }
+      const int link = connection_table<width, height>::lookup_order[static_cast<std::size_t>(next++)];
+      const position pos = connection_table<width, height>::source(p, link);
+      if (!connections.has(pos, link))
+        continue;
       if (!is_wall_block_filled(pos)) {
         count++;
         add_wall_block(pos);
       }
-      count += expand_wall(visited, pos);
+      if (!is_visited(pos)) {
+        mark_visited(pos);
+        expansion_stack.push_back({ pos, 0 });
+      }
     }
     return count;
   }
 
-  constexpr int expand_wall(const position & p) {
-    std::vector<position> visited;
-    return expand_wall(visited, p);
-  }
-
   constexpr bool add_wall() {
-    collect_valid_starting_positions();
-    collect_connections();
+    update_free_positions_and_connections();
     if (free_positions.empty())
       return false;
     position p = free_positions[get_random() % free_positions.size()];
@@ -304,27 +1043,84 @@ struct half_map {
   }
 };
 
+// How a map is written, picked by the format spec: "{}" for emoji,
+// "{:a}" for one ASCII character per cell ('#' for walls, '.' otherwise)
+// and "{:p}" for a binary PBM (P4) image with walls in black.
+enum class map_encoding {
+  emoji,
+  ascii,
+  pbm,
+};
+
 template<std::size_t width, std::size_t height>
 struct fmt::formatter<map<width, height>> {
+  map_encoding encoding = map_encoding::emoji;
+
   constexpr auto parse(format_parse_context & ctx) -> auto {
-    return ctx.begin();
+    auto it = ctx.begin();
+    if (it != ctx.end() && *it != '}') {
+      if (*it == 'a')
+        encoding = map_encoding::ascii;
+      else if (*it == 'p')
+        encoding = map_encoding::pbm;
+      else
+        throw format_error("invalid map format, expected 'a' or 'p'");
+      ++it;
+    }
+    if (it != ctx.end() && *it != '}')
+      throw format_error("invalid map format, expected 'a' or 'p'");
+    return it;
   }
+
+  // Every row is built in a buffer and written with a single copy.
   template<typename FormatContext>
   auto format(const map<width, height> & m, FormatContext & ctx)
     -> decltype(ctx.out()) {
-    for (auto && [y, x] : polyfill::product(
-           std::views::iota(0uz, height),
-           std::views::iota(0uz, width))) {
-      format_to(ctx.out(), "{}", m.walls[x, y] ? "🟨" : "🟦");
-      if (x == width - 1)
-        format_to(ctx.out(), "\n");
+    const auto [w, h] = std::pair{ m.walls.extent.width, m.walls.extent.height };
+    auto out = ctx.out();
+    std::string row;
+    if (encoding == map_encoding::pbm)
+      out = fmt::format_to(out, "P4\n{} {}\n", w, h);
+    for (std::size_t y = 0; y < h; y++) {
+      row.clear();
+      switch (encoding) {
+      case map_encoding::emoji:
+        for (std::size_t x = 0; x < w; x++)
+          row += m.walls[x, y] ? "🟨" : "🟦";
+        row += '\n';
+        break;
+      case map_encoding::ascii:
+        for (std::size_t x = 0; x < w; x++)
+          row += m.walls[x, y] ? '#' : '.';
+        row += '\n';
+        break;
+      case map_encoding::pbm:
+        // Eight cells per byte, the first one in the highest bit, rows
+        // padded to whole bytes.
+        row.assign((w + 7) / 8, '\0');
+        for (std::size_t x = 0; x < w; x++) {
+          if (m.walls[x, y])
+            row[x / 8] = static_cast<char>(row[x / 8] | (0x80 >> (x % 8)));
+        }
+        break;
+      }
+      out = std::copy(row.begin(), row.end(), out);
     }
-    return ctx.out();
+    return out;
   }
 };
 
-constexpr auto create_random_map() {
-  half_map<16, 31> hm(R"(
+template<std::size_t width, std::size_t height>
+struct fmt::formatter<packed_map<width, height>> : fmt::formatter<map<width, height>> {
+  template<typename FormatContext>
+  auto format(const packed_map<width, height> & m, FormatContext & ctx)
+    -> decltype(ctx.out()) {
+    return fmt::formatter<map<width, height>>::format(map<width, height>{ m }, ctx);
+  }
+};
+
+constexpr auto create_map_template() {
+  return half_map<16, 31>(R"(
 ||||||||||||||||
 |...............
 |...............
@@ -356,9 +1152,54 @@ constexpr auto create_random_map() {
 |...............
 |...............
 ||||||||||||||||)");
+}
 
+// A random map from the built-in template. Like the overloads below, only
+// the packed walls are returned: the generation workspace stays behind, as
+// in maze_generator.
+constexpr auto create_random_map() {
+  auto hm = create_map_template();
   while (hm.add_wall())
     ;
 
+  return packed_map{ hm };
+}
+
+using dynamic_half_map = half_map<std::dynamic_extent, std::dynamic_extent>;
+
+// Adds a wall on every side but the mirror axis.
+template<typename HalfMap>
+constexpr HalfMap add_border(HalfMap hm) {
+  for (std::size_t y = 0; y < hm.extent.height; y++) {
+    for (std::size_t x = 0; x < hm.extent.width; x++) {
+      if (x == 0 || y == 0 || y == hm.extent.height - 1)
+        hm.walls.set(x, y);
+    }
+  }
   return hm;
 }
+
+template<std::size_t width, std::size_t height>
+constexpr auto create_empty_template() {
+  return add_border(half_map<width, height>{});
+}
+
+constexpr auto create_empty_template(std::size_t width, std::size_t height) {
+  return add_border(dynamic_half_map(width, height));
+}
+
+// The same map for the same template, seed and stream, at compile time or
+// at runtime.
+template<std::size_t width, std::size_t height, typename Walls>
+constexpr packed_map<mirrored_width(width), height> create_random_map(half_map<width, height, Walls> hm, std::uint64_t seed,
+                                                                     std::uint64_t stream) {
+  hm.seed(seed, stream);
+  while (hm.add_wall())
+    ;
+
+  return packed_map{ hm };
+}
+
+constexpr auto create_random_map(std::uint64_t seed, std::uint64_t stream) {
+  return create_random_map(create_map_template(), seed, stream);
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "map.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// With MAZE_BUILDER_WRAP_TUNNELS the left and right edges of a map are
+// joined, as through the tunnels of the arcade game: a corridor cell on
+// one edge opens onto the corridor cell across the map on the same row.
+#ifdef MAZE_BUILDER_WRAP_TUNNELS
+inline constexpr bool wrap_tunnels = true;
+#else
+inline constexpr bool wrap_tunnels = false;
+#endif
+
+// The directions out of a cell, one bit each in a movement mask.
+enum class direction : std::uint8_t {
+  up = 1,
+  right = 2,
+  down = 4,
+  left = 8,
+};
+
+// For every cell, the directions leading to a corridor cell, so that a
+// movement check is a single load and test. Walls have no open direction,
+// nor has anything outside the map.
+//
+// The masks are stored twice: one byte per cell, and packed 16 cells to a
+// 64-bit word, cell x of a row in bits 4 * (x % 16) to 4 * (x % 16) + 3
+// of word x / 16, rows padded to whole words.
+template<std::size_t width, std::size_t height, bool wrap = wrap_tunnels>
+struct movement_masks {
+  static constexpr bool is_dynamic = grid_extent<width, height>::is_dynamic;
+  static constexpr std::size_t cells_per_word = 16;
+
+  board<std::uint8_t, width, height> cells;
+  std::conditional_t<is_dynamic,
+                     std::vector<std::uint64_t>,
+                     std::array<std::uint64_t, (width + cells_per_word - 1) / cells_per_word * height>>
+    packed{};
+
+  // Computed from the walls 64 cells at a time: each open direction is a
+  // row of corridor cells masked by the neighbouring row, or by the row
+  // itself shifted by one cell, and the four directions are then
+  // interleaved into the packed masks.
+  constexpr explicit movement_masks(const map<width, height> & m)
+    : cells(make_grid<board<std::uint8_t, width, height>>(m.walls.extent.width, m.walls.extent.height)) {
+    if constexpr (is_dynamic)
+      packed.resize(words_per_row() * cells.extent.height);
+
+    const std::size_t w = cells.extent.width;
+    const std::size_t h = cells.extent.height;
+    const std::size_t stride = m.walls.words_per_row();
+    const auto open = [&](std::ptrdiff_t y, std::size_t i) -> std::uint64_t {
+      if (y < 0 || static_cast<std::size_t>(y) >= h)
+        return 0;
+      const std::size_t bits = w - i * 64 < 64 ? w - i * 64 : 64;
+      return ~m.walls.row(static_cast<std::size_t>(y))[i] & bitboard<width, height>::mask(bits);
+    };
+
+    for (std::size_t y = 0; y < h; y++) {
+      const auto row = static_cast<std::ptrdiff_t>(y);
+      // The open cells of the row, with a word of margin on both sides for
+      // the neighbours across word boundaries.
+      std::uint64_t before = 0;
+      std::uint64_t current = open(row, 0);
+      for (std::size_t i = 0; i < stride; i++) {
+        const std::uint64_t after = i + 1 < stride ? open(row, i + 1) : 0;
+        std::uint64_t right = current & ((current >> 1) | (after << 63));
+        std::uint64_t left = current & ((current << 1) | (before >> 63));
+        if constexpr (wrap) {
+          if (i == 0 && ((open(row, stride - 1) >> ((w - 1) % 64)) & 1u))
+            left |= current & 1u;
+          if (i == stride - 1 && (open(row, 0) & 1u))
+            right |= current & (std::uint64_t{ 1 } << ((w - 1) % 64));
+        }
+        const std::uint64_t up = current & open(row - 1, i);
+        const std::uint64_t down = current & open(row + 1, i);
+        for (std::size_t part = 0; part < 4 && i * 4 + part < words_per_row(); part++) {
+          const std::size_t shift = part * cells_per_word;
+          packed[y * words_per_row() + i * 4 + part] = spread<4>(up >> shift) | spread<4>(right >> shift) << 1 |
+                                                       spread<4>(down >> shift) << 2 | spread<4>(left >> shift) << 3;
+        }
+        for (std::size_t x = i * 64; x < w && x < i * 64 + 64; x += 8) {
+          const std::size_t shift = x % 64;
+          const auto bytes = std::bit_cast<std::array<std::uint8_t, 8>>(
+            little_endian(spread<8>(up >> shift) | spread<8>(right >> shift) << 1 | spread<8>(down >> shift) << 2 |
+                          spread<8>(left >> shift) << 3));
+          std::copy_n(bytes.begin(), std::min<std::size_t>(8, w - x), cells.cells.begin() + static_cast<std::ptrdiff_t>(y * w + x));
+        }
+        before = std::exchange(current, after);
+      }
+    }
+  }
+
+  constexpr std::size_t words_per_row() const {
+    return (cells.extent.width + cells_per_word - 1) / cells_per_word;
+  }
+
+  constexpr const std::uint64_t * packed_row(std::size_t y) const {
+    return packed.data() + y * words_per_row();
+  }
+
+  constexpr std::uint8_t operator[](std::size_t x, std::size_t y) const {
+    return cells[x, y];
+  }
+
+  constexpr bool can_move(std::size_t x, std::size_t y, direction d) const {
+    return (cells[x, y] & static_cast<std::uint8_t>(d)) != 0;
+  }
+
+private:
+  // The low 64 / `every` bits of `bits`, moved to every `every`th bit.
+  template<std::size_t every>
+  static constexpr std::uint64_t spread(std::uint64_t bits) {
+    if constexpr (every == 4) {
+      bits &= 0xffff;
+      bits = (bits | bits << 24) & 0x000000ff000000ffu;
+      bits = (bits | bits << 12) & 0x000f000f000f000fu;
+      bits = (bits | bits << 6) & 0x0303030303030303u;
+      bits = (bits | bits << 3) & 0x1111111111111111u;
+    } else {
+      bits &= 0xff;
+      bits = (bits | bits << 28) & 0x0000000f0000000fu;
+      bits = (bits | bits << 14) & 0x0003000300030003u;
+      bits = (bits | bits << 7) & 0x0101010101010101u;
+    }
+    return bits;
+  }
+
+  // Byte k of the result is byte k from the lowest of `value`.
+  static constexpr std::uint64_t little_endian(std::uint64_t value) {
+    if constexpr (std::endian::native == std::endian::big)
+      return std::byteswap(value);
+    else
+      return value;
+  }
+};
+
+template<std::size_t width, std::size_t height>
+movement_masks(map<width, height>) -> movement_masks<width, height>;
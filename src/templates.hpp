@@ -0,0 +1,84 @@
+#pragma once
+#include "map.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Half map templates read at runtime, in the format of
+// create_map_template(): one line per row, '|' for a wall and '.' for a
+// free cell. Blank lines and trailing whitespace are ignored.
+
+// A template that cannot be read, with the line and column (both from 1)
+// of the problem, or 0 when it is not about a single character.
+struct template_error : std::runtime_error {
+  template_error(const std::string & what, std::size_t line = 0, std::size_t column = 0)
+    : std::runtime_error(what),
+      line(line),
+      column(column) {
+  }
+
+  // "line <line>, column <column>: <what>"
+  static template_error at(std::size_t line, std::size_t column, const std::string & what) {
+    return { "line " + std::to_string(line) + ", column " + std::to_string(column) + ": " + what, line, column };
+  }
+
+  std::size_t line;
+  std::size_t column;
+};
+
+// Checks every row while splitting `text` into lines, then sets the walls
+// from the rows. Linear in the size of the text.
+inline dynamic_half_map parse_template(std::string_view text, std::size_t max_cells = std::size_t{ 1 } << 28) {
+  std::vector<std::string_view> rows;
+  std::size_t line = 0;
+  while (!text.empty()) {
+    line++;
+    const auto end = text.find('\n');
+    std::string_view row = text.substr(0, end);
+    text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+    const auto last = row.find_last_not_of(" \t\r");
+    row = row.substr(0, last == std::string_view::npos ? 0 : last + 1);
+    if (row.empty())
+      continue;
+    if (const auto bad = row.find_first_not_of("|."); bad != std::string_view::npos)
+      throw template_error::at(line, bad + 1, std::string("unexpected character '") + row[bad] + "', expected '|' or '.'");
+    if (!rows.empty() && row.size() != rows.front().size())
+      throw template_error::at(line, std::min(row.size(), rows.front().size()) + 1,
+                               "row has " + std::to_string(row.size()) + " cells, the first row has " + std::to_string(rows.front().size()));
+    rows.push_back(row);
+  }
+  if (rows.empty())
+    throw template_error("template has no rows");
+  if (rows.front().size() * rows.size() > max_cells)
+    throw template_error("template has more than " + std::to_string(max_cells) + " cells");
+
+  dynamic_half_map hm(rows.front().size(), rows.size());
+  for (std::size_t y = 0; y < rows.size(); y++) {
+    for (std::size_t x = 0; x < rows[y].size(); x++) {
+      if (rows[y][x] == '|')
+        hm.walls.set(x, y);
+    }
+  }
+  return hm;
+}
+
+inline dynamic_half_map load_template(const std::filesystem::path & path, std::size_t max_cells = std::size_t{ 1 } << 28) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    throw template_error("cannot open template " + path.string());
+  const std::string text{ std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+  if (in.bad())
+    throw template_error("cannot read template " + path.string());
+  try {
+    return parse_template(text, max_cells);
+  } catch (const template_error & e) {
+    throw template_error(path.string() + ": " + e.what(), e.line, e.column);
+  }
+}
@@ -0,0 +1,239 @@
+#pragma once
+#include "batch.hpp"
+#include "map.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Generation of large maps as a grid of tiles, each tile on its own thread.
+namespace tiled {
+
+// Draws available to each tile before its sequence would run into the
+// next one's, far more than any tile uses.
+inline constexpr std::uint64_t tile_draws = std::uint64_t{ 1 } << 40;
+
+struct tile {
+  std::size_t x, y, width, height;
+};
+
+// The runs a row or a column `extent` cells long is cut into: `first`
+// cells, then `tile_size` cells each, the last one taking the remainder.
+inline std::vector<std::pair<std::size_t, std::size_t>> runs(std::size_t extent, std::size_t tile_size, std::size_t first) {
+  std::vector<std::pair<std::size_t, std::size_t>> cuts;
+  for (std::size_t begin = 0, end = std::min(first, extent); begin < extent;
+       begin = end, end = std::min(end + tile_size, extent))
+    cuts.emplace_back(begin, end);
+  return cuts;
+}
+
+// Tiles of `tile_width` x `tile_height` covering a `width` x `height`
+// half map, row by row. The last row and column take the remainder.
+inline std::vector<tile> split(std::size_t width, std::size_t height, std::size_t tile_width, std::size_t tile_height) {
+  std::vector<tile> tiles;
+  for (const auto & [y0, y1] : runs(height, tile_height, tile_height)) {
+    for (const auto & [x0, x1] : runs(width, tile_width, tile_width))
+      tiles.push_back({ x0, y0, x1 - x0, y1 - y0 });
+  }
+  return tiles;
+}
+
+// Tiles keep a free cell along their edges, so a block placed against
+// one lies within this many cells of it.
+inline constexpr std::size_t seam_band = 3;
+
+// Whether coordinate `c` of a map `extent` long, split every `tile_size`,
+// lies within seam_band of a seam between two tiles.
+inline bool near_seam(std::size_t c, std::size_t extent, std::size_t tile_size) {
+  const std::size_t offset = c % tile_size;
+  const bool after = c >= tile_size && offset < seam_band;
+  const bool before = c - offset + tile_size < extent && tile_size - offset <= seam_band;
+  return after || before;
+}
+
+// The runs of a split every `tile_size` moved by half a tile, so that each
+// seam runs through the middle of one. Only those reaching a seam band
+// are kept.
+inline std::vector<std::pair<std::size_t, std::size_t>> runs_across_seams(std::size_t extent, std::size_t tile_size) {
+  auto cuts = runs(extent, tile_size, tile_size / 2);
+  std::erase_if(cuts, [&](const auto & run) {
+    for (std::size_t c = run.first; c < run.second; c++) {
+      if (near_seam(c, extent, tile_size))
+        return false;
+    }
+    return true;
+  });
+  return cuts;
+}
+
+// The tiles that fill the seam bands of split(), in two rounds. First
+// strips the height of the map across the vertical seams: they fill
+// those bands and the horizontal ones but where a strip ends. Then tiles
+// between the vertical seams across the horizontal ones, whose sides lie
+// in the bands the strips filled.
+inline std::vector<tile> split_across_vertical_seams(std::size_t width, std::size_t height, std::size_t tile_width) {
+  std::vector<tile> strips;
+  for (const auto & [x0, x1] : runs_across_seams(width, tile_width))
+    strips.push_back({ x0, 0, x1 - x0, height });
+  return strips;
+}
+
+inline std::vector<tile> split_across_horizontal_seams(std::size_t width, std::size_t height, std::size_t tile_width,
+                                                       std::size_t tile_height) {
+  std::vector<tile> tiles;
+  for (const auto & [y0, y1] : runs_across_seams(height, tile_height)) {
+    for (const auto & [x0, x1] : runs(width, tile_width, tile_width))
+      tiles.push_back({ x0, y0, x1 - x0, y1 - y0 });
+  }
+  return tiles;
+}
+
+// Fills `tiles` of `hm` on `threads` threads, tile i of them drawing from
+// `base` advanced by (first + i) * tile_draws. Each tile starts from its
+// own copy of the walls under it, taken from a snapshot so that the
+// calling thread can add the walls of the finished tiles to `hm` while
+// the workers fill the next ones. The walls within seam_band of an edge a
+// tile shares with another are left out: the tile took that edge for the
+// border.
+template<typename HalfMap>
+void fill_tiles(HalfMap & hm, const std::vector<tile> & tiles, const rng::PCG & base, std::size_t first, std::size_t threads) {
+  const auto snapshot = hm.walls;
+  const auto near_edge = [](std::size_t c, std::size_t start, std::size_t size, std::size_t extent) {
+    return (start > 0 && c < seam_band) || (start + size < extent && size - c <= seam_band);
+  };
+  batch::run(
+    tiles.size(), threads,
+    [&](std::size_t index) {
+      const tile & t = tiles[index];
+      dynamic_half_map part(t.width, t.height);
+      for (std::size_t y = 0; y < t.height; y++) {
+        for (std::size_t x = 0; x < t.width; x++)
+          part.walls.set(x, y, snapshot[t.x + x, t.y + y]);
+      }
+      part.pcg = base.jumped((first + index) * tile_draws);
+      while (part.add_wall())
+        ;
+      return part;
+    },
+    [&](std::size_t index, const dynamic_half_map & part) {
+      const tile & t = tiles[index];
+      for (std::size_t y = 0; y < t.height; y++) {
+        if (near_edge(y, t.y, t.height, hm.extent.height))
+          continue;
+        for (std::size_t x = 0; x < t.width; x++) {
+          if (part.walls[x, y] && !near_edge(x, t.x, t.width, hm.extent.width))
+            hm.walls.set(t.x + x, t.y + y);
+        }
+      }
+    });
+}
+
+// Clears the walls of `hm` not in `template_walls` that are outside every
+// 2x2 square of walls, what is left of the blocks a cut went through. On
+// a bitboard 64 cells at a time: a cell is in a square when it and its
+// neighbour on the left or on the right are walls in its row and in the
+// row above or below.
+template<std::size_t width, std::size_t height, typename Walls>
+void clear_cut_blocks(half_map<width, height, Walls> & hm, const Walls & template_walls) {
+  const std::size_t w = hm.extent.width;
+  const std::size_t h = hm.extent.height;
+  const Walls cut = hm.walls;
+  if constexpr (std::is_same_v<Walls, bitboard<width, height>>) {
+    for (std::size_t x = 0; x < w; x += Walls::word_bits) {
+      const std::size_t count = std::min(Walls::word_bits, w - x);
+      // Cells x.. of row `y` in pairs with their left or their right
+      // neighbour; the row below the last has no walls.
+      const auto pairs = [&](std::size_t y) -> std::pair<std::uint64_t, std::uint64_t> {
+        if (y >= h)
+          return { 0, 0 };
+        const std::uint64_t cells = cut.bits(x, y, count);
+        const std::uint64_t left = x > 0 ? cut.bits(x - 1, y, count) : cells << 1;
+        return { cells & left, cells & cut.bits(x + 1, y, count) };
+      };
+      std::pair<std::uint64_t, std::uint64_t> above{ 0, 0 };
+      auto row = pairs(0);
+      for (std::size_t y = 0; y < h; y++) {
+        const auto below = pairs(y + 1);
+        const std::uint64_t in_block = (row.first & (above.first | below.first)) | (row.second & (above.second | below.second));
+        hm.walls.row(y)[x / Walls::word_bits] = cut.bits(x, y, count) & (in_block | template_walls.bits(x, y, count));
+        above = row;
+        row = below;
+      }
+    }
+  } else {
+    const auto in_block = [&](std::size_t x, std::size_t y) {
+      for (std::size_t by = y > 0 ? y - 1 : 0; by <= y && by + 1 < h; by++) {
+        for (std::size_t bx = x > 0 ? x - 1 : 0; bx <= x && bx + 1 < w; bx++) {
+          if (cut.all(bx, by, 2, 2))
+            return true;
+        }
+      }
+      return false;
+    };
+    for (std::size_t y = 0; y < h; y++) {
+      for (std::size_t x = 0; x < w; x++) {
+        if (cut[x, y] && !template_walls[x, y] && !in_block(x, y))
+          hm.walls.set(x, y, false);
+      }
+    }
+  }
+}
+
+// The walls of `hm`, a template without generated walls, filled tile by
+// tile on `threads` threads. The tiles treat their edges as the map
+// border, which leaves corridors along the seams twice as wide as
+// elsewhere: the walls the tiles placed within seam_band of a seam are
+// dropped, and what is left of the blocks they cut through cleared. The
+// tiles across the seams then fill the bands in parallel with the walls
+// on both sides in view, dropping in turn what they place near their own
+// edges, and add_wall finally runs over the whole map for any gap left,
+// under the usual block and connection rules.
+//
+// Tile i draws from PCG(seed, stream) advanced by i * tile_draws, the
+// tiles across the seams after the others and the last pass after those,
+// so the map only depends on the seed, the stream and the tile size, not
+// on the number of threads.
+template<std::size_t width, std::size_t height, typename Walls>
+packed_map<mirrored_width(width), height> create_random_map(half_map<width, height, Walls> hm, std::uint64_t seed,
+                                                           std::uint64_t stream, std::size_t tile_width, std::size_t tile_height,
+                                                           std::size_t threads) {
+  if (tile_width < 4 || tile_height < 4)
+    throw std::invalid_argument("tiles must be at least 4x4 to hold a wall block");
+
+  const rng::PCG base(seed, stream);
+  const std::size_t w = hm.extent.width;
+  const std::size_t h = hm.extent.height;
+  const Walls template_walls = hm.walls;
+  std::size_t drawn = 0;
+  for (const auto & tiles : { split(w, h, tile_width, tile_height), split_across_vertical_seams(w, h, tile_width),
+                              split_across_horizontal_seams(w, h, tile_width, tile_height) }) {
+    fill_tiles(hm, tiles, base, drawn, threads);
+    clear_cut_blocks(hm, template_walls);
+    drawn += tiles.size();
+  }
+
+  // add_wall starts from a rescan of the whole map, as the walls changed
+  // behind its incremental state; it only has work where a new block fits.
+  const auto has_gap = [&] {
+    for (std::size_t y = 0; y + 3 < h; y++) {
+      for (std::size_t x = 0; x + 3 < w; x++) {
+        if (hm.walls.none(x, y, 4, 4))
+          return true;
+      }
+    }
+    return false;
+  };
+  if (has_gap()) {
+    hm.collected = false;
+    hm.pending_blocks.clear();
+    hm.pcg = base.jumped(drawn * tile_draws);
+    while (hm.add_wall())
+      ;
+  }
+  return packed_map{ hm };
+}
+
+} // namespace tiled
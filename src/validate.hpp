@@ -0,0 +1,148 @@
+#pragma once
+#include "map.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Playability checks on a generated map, on whole rows of packed cells
+// at a time. Corridors are the cells without walls; cells outside the map
+// count as walls.
+
+struct playability_report {
+  // Cells without walls.
+  std::size_t corridor_cells = 0;
+  // Separate corridor regions, more than one means the map has pockets
+  // that cannot be reached from the rest.
+  std::size_t regions = 0;
+  // Size of the largest region.
+  std::size_t largest_region = 0;
+  // Corridor cells with a single corridor neighbour, in scan order (rows
+  // first).
+  std::vector<position> dead_ends;
+
+  bool connected() const {
+    return regions == 1;
+  }
+
+  bool playable() const {
+    return connected() && dead_ends.empty();
+  }
+};
+
+namespace validate_detail {
+
+// Row `y` of a packed grid of `stride` words per row, or nothing outside.
+inline std::uint64_t word_at(const std::vector<std::uint64_t> & rows, std::size_t stride, std::size_t height,
+                             std::ptrdiff_t y, std::size_t i) {
+  return y < 0 || static_cast<std::size_t>(y) >= height ? 0 : rows[static_cast<std::size_t>(y) * stride + i];
+}
+
+// Word `i` of a row shifted one cell towards higher x, and lower x.
+inline std::uint64_t from_left(const std::uint64_t * row, std::size_t i) {
+  return (row[i] << 1) | (i > 0 ? row[i - 1] >> 63 : 0);
+}
+
+inline std::uint64_t from_right(const std::uint64_t * row, std::size_t stride, std::size_t i) {
+  return (row[i] >> 1) | (i + 1 < stride ? row[i + 1] << 63 : 0);
+}
+
+// Grows `reach` inside `free` until it stops changing: every pass sweeps
+// the rows down then up, each row spreading sideways until it is stable,
+// so a pass carries the fill through any run of straight corridor.
+inline void flood_fill(const std::vector<std::uint64_t> & free, std::vector<std::uint64_t> & reach, std::size_t stride,
+                       std::size_t height) {
+  auto grow_row = [&](std::size_t y, std::size_t neighbour_y, bool has_neighbour) {
+    std::uint64_t * row = &reach[y * stride];
+    const std::uint64_t * open = &free[y * stride];
+    bool changed = false;
+    for (std::size_t i = 0; i < stride; i++) {
+      const std::uint64_t grown = (row[i] | (has_neighbour ? reach[neighbour_y * stride + i] : 0)) & open[i];
+      changed = changed || grown != row[i];
+      row[i] = grown;
+    }
+    for (bool spreading = true; spreading;) {
+      spreading = false;
+      for (std::size_t i = 0; i < stride; i++) {
+        const std::uint64_t grown = (row[i] | from_left(row, i) | from_right(row, stride, i)) & open[i];
+        spreading = spreading || grown != row[i];
+        row[i] = grown;
+      }
+      changed = changed || spreading;
+    }
+    return changed;
+  };
+
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (std::size_t y = 0; y < height; y++)
+      changed = grow_row(y, y - 1, y > 0) || changed;
+    for (std::size_t y = height; y-- > 0;)
+      changed = grow_row(y, y + 1, y + 1 < height) || changed;
+  }
+}
+
+inline std::size_t count_cells(const std::vector<std::uint64_t> & rows) {
+  std::size_t count = 0;
+  for (const std::uint64_t word : rows)
+    count += static_cast<std::size_t>(std::popcount(word));
+  return count;
+}
+
+} // namespace validate_detail
+
+// Finds the corridor regions by flood fills seeded from the first cell
+// not reached yet, and the dead ends by counting the corridor neighbours
+// of every cell with a bitwise adder over the four shifted neighbour rows.
+template<std::size_t width, std::size_t height>
+playability_report check_playability(const map<width, height> & m) {
+  using namespace validate_detail;
+  const std::size_t w = m.walls.extent.width;
+  const std::size_t h = m.walls.extent.height;
+  const std::size_t stride = m.walls.words_per_row();
+
+  std::vector<std::uint64_t> free(stride * h);
+  for (std::size_t y = 0; y < h; y++) {
+    for (std::size_t i = 0; i < stride; i++) {
+      const std::size_t bits = std::min<std::size_t>(64, w - i * 64);
+      free[y * stride + i] = ~m.walls.row(y)[i] & bitboard<width, height>::mask(bits);
+    }
+  }
+
+  playability_report report;
+  report.corridor_cells = count_cells(free);
+
+  std::vector<std::uint64_t> remaining = free;
+  std::vector<std::uint64_t> reach(stride * h);
+  for (std::size_t i = 0; i < remaining.size(); i++) {
+    while (remaining[i] != 0) {
+      std::ranges::fill(reach, 0);
+      reach[i] = remaining[i] & (~remaining[i] + 1);
+      flood_fill(remaining, reach, stride, h);
+      report.regions++;
+      report.largest_region = std::max(report.largest_region, count_cells(reach));
+      for (std::size_t j = 0; j < remaining.size(); j++)
+        remaining[j] &= ~reach[j];
+    }
+  }
+
+  for (std::size_t y = 0; y < h; y++) {
+    const std::uint64_t * row = &free[y * stride];
+    for (std::size_t i = 0; i < stride; i++) {
+      const std::uint64_t left = from_left(row, i);
+      const std::uint64_t right = from_right(row, stride, i);
+      const std::uint64_t up = word_at(free, stride, h, static_cast<std::ptrdiff_t>(y) - 1, i);
+      const std::uint64_t down = word_at(free, stride, h, static_cast<std::ptrdiff_t>(y) + 1, i);
+      const std::uint64_t sum_lr = left ^ right;
+      const std::uint64_t sum_ud = up ^ down;
+      const std::uint64_t odd = sum_lr ^ sum_ud;
+      const std::uint64_t two_or_more = (left & right) | (up & down) | (sum_lr & sum_ud);
+      for (std::uint64_t ends = row[i] & odd & ~two_or_more; ends != 0; ends &= ends - 1) {
+        const auto x = i * 64 + static_cast<std::size_t>(std::countr_zero(ends));
+        report.dead_ends.push_back({ static_cast<int>(x), static_cast<int>(y) });
+      }
+    }
+  }
+  return report;
+}
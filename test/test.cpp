@@ -1,10 +1,991 @@
 #define CATCH_CONFIG_MAIN
 #include <catch2/catch.hpp>
 
+#include "archive.hpp"
+#include "batch.hpp"
+#include "constraints.hpp"
+#include "corridors.hpp"
+#include "generator.hpp"
+#include "grid.hpp"
 #include "map.hpp"
+#include "movement.hpp"
+#include "templates.hpp"
+#include "tiled.hpp"
+#include "validate.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <new>
+#include <random>
+#include <stop_token>
+#include <thread>
+
+// Every heap allocation of the test binary, for the tests that check
+// there are none. The deallocation functions are kept out of line: GCC
+// otherwise sees the free() of a pointer from operator new and warns
+// about mismatched allocation functions.
+namespace {
+std::atomic<std::size_t> allocations = 0;
+}
+
+void * operator new(std::size_t size) {
+  allocations++;
+  if (void * p = std::malloc(size == 0 ? 1 : size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void * operator new(std::size_t size, std::align_val_t alignment) {
+  allocations++;
+  // aligned_alloc wants a non-zero multiple of the alignment.
+  const auto align = static_cast<std::size_t>(alignment);
+  if (void * p = std::aligned_alloc(align, size == 0 ? align : (size + align - 1) / align * align))
+    return p;
+  throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void * p) noexcept {
+  std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void * p, std::size_t) noexcept {
+  std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void * p, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void * p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+// `hm` with the walls of a generated map, rescanned, for the tests that
+// look at more than the packed walls create_random_map returns.
+template<typename HalfMap, std::size_t width, std::size_t height>
+HalfMap with_walls(HalfMap hm, const packed_map<width, height> & walls) {
+  for (std::size_t y = 0; y < hm.extent.height; y++) {
+    for (std::size_t x = 0; x < hm.extent.width; x++)
+      hm.walls.set(x, y, walls[x, y]);
+  }
+  hm.collected = false;
+  hm.update_free_positions_and_connections();
+  return hm;
+}
 
 TEST_CASE("Make map", "[maze_builder]") {
   constexpr map m{ create_random_map() };
   fmt::print("{}", m);
   REQUIRE(true == true);
 }
+
+TEST_CASE("Grid ranges visit the rectangle row by row", "[maze_builder]") {
+  constexpr grid_range grid({ 2, -1 }, { 5, 3 });
+  std::vector<position> expected;
+  for (int y = -1; y < 3; y++) {
+    for (int x = 2; x < 5; x++)
+      expected.push_back({ x, y });
+  }
+  REQUIRE(std::vector<position>(grid.begin(), grid.end()) == expected);
+  REQUIRE(grid.size() == expected.size());
+  static_assert(grid.size() == 12 && grid[4] == position{ 3, 0 });
+
+  for (std::ptrdiff_t i = 0; i <= static_cast<std::ptrdiff_t>(expected.size()); i++) {
+    const auto it = grid.begin() + i;
+    REQUIRE(it - grid.begin() == i);
+    REQUIRE(grid.end() - it == static_cast<std::ptrdiff_t>(expected.size()) - i);
+    REQUIRE((grid.end() - (static_cast<std::ptrdiff_t>(expected.size()) - i)) == it);
+    if (i < static_cast<std::ptrdiff_t>(expected.size())) {
+      REQUIRE(*it == expected[static_cast<std::size_t>(i)]);
+      REQUIRE(it < grid.end());
+      REQUIRE(std::ranges::prev(std::ranges::next(it)) == it);
+    }
+  }
+
+  std::vector<position> by_rows;
+  for (const auto row : grid.rows()) {
+    REQUIRE(row.size() == 3);
+    by_rows.insert(by_rows.end(), row.begin(), row.end());
+  }
+  REQUIRE(by_rows == expected);
+
+  const grid_range empty({ 3, 3 }, { 3, 7 });
+  REQUIRE(empty.empty());
+  REQUIRE(empty.begin() == empty.end());
+  REQUIRE(std::ranges::empty(empty.rows()));
+}
+
+TEST_CASE("Bitboard rectangle queries match board", "[maze_builder]") {
+  constexpr std::size_t width = 100, height = 9;
+  board<bool, width, height> bytes{};
+  bitboard<width, height> bits;
+  std::mt19937 gen(42);
+  for (std::size_t y = 0; y < height; y++) {
+    for (std::size_t x = 0; x < width; x++) {
+      const bool wall = gen() % 8 == 0;
+      bytes.set(x, y, wall);
+      bits.set(x, y, wall);
+    }
+  }
+  for (std::size_t y = 0; y + 4 <= height; y++) {
+    for (std::size_t x = 0; x + 4 <= width; x++) {
+      REQUIRE(bits.none(x, y, 4, 4) == bytes.none(x, y, 4, 4));
+      REQUIRE(bits.all(x, y, 2, 2) == bytes.all(x, y, 2, 2));
+      REQUIRE(bits[x, y] == bytes[x, y]);
+    }
+  }
+  bits.set(63, 0);
+  bits.set(64, 0);
+  REQUIRE(bits.bits(62, 0, 4) == 0b0110);
+  bits.set(63, 0, false);
+  REQUIRE(bits.bits(62, 0, 4) == 0b0100);
+}
+
+TEST_CASE("Incremental updates match a full rescan", "[maze_builder]") {
+  half_map<12, 12> hm(R"(
+||||||||||||
+|...........
+|...........
+|...........
+|...........
+|.....||||||
+|.....||||||
+|...........
+|...........
+|...........
+|...........
+||||||||||||)");
+  do {
+    hm.update_free_positions_and_connections();
+    REQUIRE_NOTHROW(hm.verify_incremental_update());
+  } while (hm.add_wall());
+}
+
+// The positions a new block fits at, straight from the walls: the 4x4
+// area is inside the map and has no wall cell. free_positions lists them
+// in its scan order, x then y.
+template<typename HalfMap>
+void check_free_cells(const HalfMap & hm) {
+  const auto w = static_cast<int>(hm.extent.width);
+  const auto h = static_cast<int>(hm.extent.height);
+  std::vector<position> expected;
+  for (int x = 0; x < w; x++) {
+    for (int y = 0; y < h; y++) {
+      bool fits = x + 4 <= w && y + 4 <= h;
+      for (int dy = 0; fits && dy < 4; dy++) {
+        for (int dx = 0; fits && dx < 4; dx++)
+          fits = !hm.walls[static_cast<std::size_t>(x + dx), static_cast<std::size_t>(y + dy)];
+      }
+      REQUIRE(hm.free_cells[static_cast<std::size_t>(x), static_cast<std::size_t>(y)] == fits);
+      if (fits)
+        expected.push_back({ x, y });
+    }
+  }
+  std::vector<position> listed;
+  for (std::size_t i = 0; i < hm.free_positions.size(); i++)
+    listed.push_back(hm.free_positions[i]);
+  REQUIRE(listed == expected);
+}
+
+TEST_CASE("Free cells match a brute-force scan", "[maze_builder]") {
+  const auto check_generation = [](const auto & start, std::uint64_t seed) {
+    auto hm = start;
+    hm.seed(seed, 0);
+    hm.update_free_positions_and_connections();
+    check_free_cells(hm);
+    while (hm.add_wall()) {
+      hm.update_free_positions_and_connections();
+      check_free_cells(hm);
+    }
+    REQUIRE(hm.free_positions.empty());
+
+    // The map create_random_map returns, rescanned.
+    const auto finished = with_walls(start, create_random_map(start, seed, 0));
+    REQUIRE(finished.walls == hm.walls);
+    check_free_cells(finished);
+  };
+  for (std::uint64_t seed = 0; seed < 4; seed++) {
+    check_generation(create_map_template(), seed);
+    check_generation(create_empty_template(37, 21), seed);
+  }
+}
+
+TEST_CASE("Connection lookup lists sources in scan order", "[maze_builder]") {
+  half_map<12, 12> hm(R"(
+||||||||||||
+|...........
+|...........
+|...........
+|...........
+|.....||||||
+|.....||||||
+|...........
+|...........
+|...........
+|...........
+||||||||||||)");
+  hm.update_free_positions_and_connections();
+  using table = decltype(hm.connections);
+
+  // Scan the sources columns first, the order collect_connections visits them in.
+  std::map<std::pair<int, int>, std::vector<position>> expected;
+  for (int x = 0; x < 12; x++) {
+    for (int y = 0; y < 12; y++) {
+      for (int link = 0; link < table::link_count; link++) {
+        if (hm.connections.has({ x, y }, link))
+          expected[{ x + table::offset(link).x, y + table::offset(link).y }].push_back({ x, y });
+      }
+    }
+  }
+  REQUIRE(!expected.empty());
+  for (int x = 0; x < 12; x++) {
+    for (int y = 0; y < 12; y++) {
+      std::vector<position> sources;
+      std::ranges::copy(hm.connections.sources({ x, y }), std::back_inserter(sources));
+      REQUIRE(sources == expected[{ x, y }]);
+    }
+  }
+}
+
+// The recursive expand_wall the walk replaced, with its visited check the
+// right way round.
+template<typename HalfMap>
+int recursive_expand_wall(HalfMap & hm, std::vector<position> & visited, const position & p) {
+  if (std::ranges::find(visited, p) != std::ranges::end(visited))
+    return 0;
+  visited.push_back(p);
+
+  int count = 0;
+  for (const position pos : hm.connections.sources(p)) {
+    if (!hm.is_wall_block_filled(pos)) {
+      count++;
+      hm.add_wall_block(pos);
+    }
+    count += recursive_expand_wall(hm, visited, pos);
+  }
+  return count;
+}
+
+TEST_CASE("Wall expansion matches the recursive walk", "[maze_builder]") {
+  const auto check = [](auto hm, std::uint64_t seed) {
+    hm.seed(seed, 0);
+    for (int step = 0; step < 12; step++) {
+      hm.update_free_positions_and_connections();
+      for (std::size_t i = 0; i < hm.free_positions.size(); i++) {
+        const position start = hm.free_positions[i];
+        auto walked = hm;
+        auto recursed = hm;
+        walked.add_wall_block(start);
+        recursed.add_wall_block(start);
+        std::vector<position> visited;
+        REQUIRE(walked.expand_wall(start) == recursive_expand_wall(recursed, visited, start));
+        REQUIRE(walked.walls == recursed.walls);
+      }
+      if (!hm.add_wall())
+        break;
+    }
+  };
+  for (std::uint64_t seed = 0; seed < 4; seed++) {
+    check(create_map_template(), seed);
+    check(create_empty_template(40, 24), seed);
+  }
+}
+
+TEST_CASE("Wall expansion fills every connected block", "[maze_builder]") {
+  auto hm = create_map_template();
+  hm.seed(3);
+  for (int i = 0; i < 5; i++)
+    hm.add_wall();
+  hm.update_free_positions_and_connections();
+
+  for (std::size_t i = 0; i < hm.free_positions.size(); i++) {
+    const position start = hm.free_positions[i];
+    std::vector<position> reached{ start };
+    for (std::size_t next = 0; next < reached.size(); next++) {
+      for (const position pos : hm.connections.sources(reached[next])) {
+        if (std::ranges::find(reached, pos) == reached.end())
+          reached.push_back(pos);
+      }
+    }
+
+    auto expanded = hm;
+    expanded.add_wall_block(start);
+    expanded.expand_wall(start);
+    for (const position pos : reached)
+      REQUIRE(expanded.is_wall_block_filled(pos));
+  }
+}
+
+TEST_CASE("Wall groups match a flood fill", "[maze_builder]") {
+  const auto hm = with_walls(create_map_template(), create_random_map(create_map_template(), 4, 0));
+
+  board<int, 16, 31> component{};
+  std::vector<std::size_t> sizes;
+  for (const auto & start : hm.all_positions()) {
+    if (!hm.is_wall(start) || component[start.x, start.y] != 0)
+      continue;
+    sizes.push_back(0);
+    std::vector<position> todo{ start };
+    component[start.x, start.y] = static_cast<int>(sizes.size());
+    while (!todo.empty()) {
+      const position p = todo.back();
+      todo.pop_back();
+      sizes.back()++;
+      for (const position next : { position{ p.x + 1, p.y }, position{ p.x - 1, p.y }, position{ p.x, p.y + 1 }, position{ p.x, p.y - 1 } }) {
+        if (hm.is_wall(next) && component[next.x, next.y] == 0) {
+          component[next.x, next.y] = static_cast<int>(sizes.size());
+          todo.push_back(next);
+        }
+      }
+    }
+  }
+
+  REQUIRE(hm.wall_group_count() == sizes.size());
+  for (const auto & a : hm.all_positions()) {
+    if (!hm.is_wall(a)) {
+      REQUIRE(hm.wall_group(a) == disjoint_sets::none);
+      REQUIRE(hm.wall_group_size(a) == 0);
+      continue;
+    }
+    REQUIRE(hm.wall_group_size(a) == sizes[static_cast<std::size_t>(component[a.x, a.y] - 1)]);
+    const position right{ a.x + 1, a.y };
+    if (hm.is_wall(right))
+      REQUIRE(hm.wall_group(a) == hm.wall_group(right));
+  }
+}
+
+TEST_CASE("Maps format in every encoding", "[maze_builder]") {
+  const map m{ create_random_map(1, 0) };
+  const std::string emoji = fmt::format("{}", m);
+  const std::string ascii = fmt::format("{:a}", m);
+  const std::string pbm = fmt::format("{:p}", m);
+
+  REQUIRE(ascii.size() == (32 + 1) * 31);
+  const std::string header = "P4\n32 31\n";
+  REQUIRE(pbm.size() == header.size() + 4 * 31);
+  REQUIRE(pbm.starts_with(header));
+  std::size_t emoji_offset = 0;
+  for (std::size_t y = 0; y < 31; y++) {
+    for (std::size_t x = 0; x < 32; x++) {
+      const bool wall = m.walls[x, y];
+      REQUIRE(ascii[y * 33 + x] == (wall ? '#' : '.'));
+      const auto byte = static_cast<unsigned char>(pbm[header.size() + y * 4 + x / 8]);
+      REQUIRE(((byte >> (7 - x % 8)) & 1u) == (wall ? 1u : 0u));
+      const std::string_view cell = wall ? "🟨" : "🟦";
+      REQUIRE(std::string_view(emoji).substr(emoji_offset, cell.size()) == cell);
+      emoji_offset += cell.size();
+    }
+    REQUIRE(ascii[y * 33 + 32] == '\n');
+    REQUIRE(emoji[emoji_offset++] == '\n');
+  }
+  REQUIRE(emoji_offset == emoji.size());
+  REQUIRE_THROWS_AS(fmt::format(fmt::runtime("{:x}"), m), fmt::format_error);
+}
+
+TEST_CASE("Archives read back the maps they were written with", "[maze_builder]") {
+  const auto path = std::filesystem::temp_directory_path() / "maze_builder_test.mzba";
+  const map fixed{ create_random_map(5, 0) };
+  const auto large = with_walls(create_empty_template(70, 40), create_random_map(create_empty_template(70, 40), 5, 1));
+  {
+    archive::writer out(path);
+    out.add(fixed);
+    out.add(large);
+    out.add(create_map_template());
+    out.finish();
+  }
+
+  const archive::reader in(path);
+  REQUIRE(in.count() == 3);
+  const auto first = in[0];
+  REQUIRE(first.width() == 32);
+  REQUIRE(first.height() == 31);
+  for (std::size_t y = 0; y < 31; y++) {
+    for (std::size_t x = 0; x < 32; x++)
+      REQUIRE(first[x, y] == fixed.walls[x, y]);
+  }
+  const auto second = in[1];
+  const map large_map{ large };
+  REQUIRE(second.width() == 140);
+  for (std::size_t y = 0; y < 40; y++) {
+    for (std::size_t x = 0; x < 140; x++)
+      REQUIRE(second[x, y] == large_map.walls[x, y]);
+  }
+  REQUIRE_THROWS_AS(in[3], std::out_of_range);
+  REQUIRE(!first.has_graph());
+
+  {
+    const auto graph = build_corridor_graph(fixed);
+    archive::writer out(path);
+    out.add(fixed, &graph);
+    out.add(large);
+    out.finish();
+    const archive::reader with_graph(path);
+    const auto view = with_graph[0];
+    REQUIRE(view.has_graph());
+    REQUIRE(view.junction_count() == graph.junctions.size());
+    REQUIRE(view.segment_count() == graph.segments.size());
+    for (std::size_t i = 0; i < graph.junctions.size(); i++) {
+      REQUIRE(view.junction(i) == graph.junctions[i]);
+      for (std::size_t j = 0; j < graph.junctions.size(); j++)
+        REQUIRE(view.junction_distance(i, j) == graph.junction_distance(i, j));
+    }
+    for (std::size_t i = 0; i < graph.segments.size(); i++)
+      REQUIRE(view.segment(i) == graph.segments[i]);
+    REQUIRE(!with_graph[1].has_graph());
+    REQUIRE(with_graph[1][3, 5] == large_map.walls[3, 5]);
+  }
+
+  {
+    // A graph without corridors is still a graph.
+    const auto walled = parse_template("||||\n||||\n||||\n");
+    const auto graph = build_corridor_graph(map{ walled });
+    REQUIRE(graph.junctions.empty());
+    archive::writer out(path);
+    out.add(walled, &graph);
+    out.add(walled);
+    out.finish();
+    const archive::reader in_walled(path);
+    REQUIRE(in_walled[0].has_graph());
+    REQUIRE(in_walled[0].junction_count() == 0);
+    REQUIRE(in_walled[0].segment_count() == 0);
+    REQUIRE(!in_walled[1].has_graph());
+  }
+
+  {
+    std::ofstream corrupt(path, std::ios::binary | std::ios::in | std::ios::out);
+    corrupt.write("MZBB", 4);
+  }
+  REQUIRE_THROWS_AS(archive::reader(path), std::runtime_error);
+  std::filesystem::remove(path);
+  REQUIRE_THROWS_AS(archive::reader(path), std::runtime_error);
+}
+
+TEST_CASE("Corridor distances match a search on the grid", "[maze_builder]") {
+  const auto check = [](const auto & m) {
+    const auto graph = build_corridor_graph(m);
+    REQUIRE(build_corridor_graph(m, 4).distances == graph.distances);
+    const int w = static_cast<int>(graph.width);
+    const int h = static_cast<int>(graph.height);
+    const auto open = [&](position p) {
+      return p.x >= 0 && p.y >= 0 && p.x < w && p.y < h && !m.walls[p.x, p.y];
+    };
+
+    // Every corridor cell is on exactly one junction or segment, and the
+    // segments are as long as the runs of cells on them.
+    std::vector<std::uint32_t> cells(graph.segments.size(), 0);
+    for (int y = 0; y < h; y++) {
+      for (int x = 0; x < w; x++) {
+        const auto & place = graph.place_of({ x, y });
+        REQUIRE(open({ x, y }) == (place.junction != corridor_graph::none || place.segment != corridor_graph::none));
+        REQUIRE((place.junction == corridor_graph::none || place.segment == corridor_graph::none));
+        if (place.segment != corridor_graph::none)
+          cells[place.segment]++;
+      }
+    }
+    for (std::size_t s = 0; s < graph.segments.size(); s++)
+      REQUIRE(graph.segments[s].length == cells[s] + 1);
+
+    for (int y = 0; y < h; y++) {
+      for (int x = 0; x < w; x++) {
+        if (!open({ x, y }))
+          continue;
+        std::vector<std::uint32_t> steps(static_cast<std::size_t>(w * h), corridor_graph::none);
+        std::vector<position> frontier{ { x, y } };
+        steps[static_cast<std::size_t>(y * w + x)] = 0;
+        for (std::size_t i = 0; i < frontier.size(); i++) {
+          const position p = frontier[i];
+          for (const position n : { position{ p.x + 1, p.y }, position{ p.x - 1, p.y }, position{ p.x, p.y + 1 }, position{ p.x, p.y - 1 } }) {
+            if (open(n) && steps[static_cast<std::size_t>(n.y * w + n.x)] == corridor_graph::none) {
+              steps[static_cast<std::size_t>(n.y * w + n.x)] = steps[static_cast<std::size_t>(p.y * w + p.x)] + 1;
+              frontier.push_back(n);
+            }
+          }
+        }
+        for (int ty = 0; ty < h; ty++) {
+          for (int tx = 0; tx < w; tx++) {
+            if (open({ tx, ty }))
+              REQUIRE(graph.distance({ x, y }, { tx, ty }) == steps[static_cast<std::size_t>(ty * w + tx)]);
+          }
+        }
+      }
+    }
+  };
+
+  check(map{ create_random_map(4, 0) });
+  check(map{ create_random_map(create_empty_template(24, 16), 9, 0) });
+  // Loops without junctions, and a single cell.
+  check(map{ parse_template("|||||\n|...|\n|.|.|\n|...|\n|||||\n|.|||\n|||||\n") });
+  check(map{ parse_template("||||\n|...\n|.||\n|...\n||||\n") });
+}
+
+TEST_CASE("Templates parse at runtime and report errors", "[maze_builder]") {
+  const auto fixed = create_map_template();
+  std::string text;
+  for (std::size_t y = 0; y < 31; y++) {
+    for (std::size_t x = 0; x < 16; x++)
+      text += fixed.walls[x, y] ? '|' : '.';
+    text += y % 2 ? "  \r\n" : "\n\n";
+  }
+  const auto loaded = parse_template(text);
+  REQUIRE(loaded.extent.width == 16);
+  REQUIRE(loaded.extent.height == 31);
+  for (std::size_t y = 0; y < 31; y++) {
+    for (std::size_t x = 0; x < 16; x++)
+      REQUIRE(loaded.walls[x, y] == fixed.walls[x, y]);
+  }
+
+  const auto error = [](std::string_view bad) -> template_error {
+    try {
+      parse_template(bad);
+    } catch (const template_error & e) {
+      return e;
+    }
+    FAIL("no error");
+    return template_error("");
+  };
+  const auto character = error("||||\n|..x\n");
+  REQUIRE(character.line == 2);
+  REQUIRE(character.column == 4);
+  const auto ragged = error("||||\n\n|..\n");
+  REQUIRE(ragged.line == 3);
+  REQUIRE(ragged.column == 4);
+  REQUIRE(error(" \n\n").line == 0);
+  REQUIRE_THROWS_AS(parse_template("||||\n||||\n", 7), template_error);
+  REQUIRE_THROWS_AS(load_template("/nonexistent/template.txt"), template_error);
+  REQUIRE_THROWS_AS((half_map<4, 2>("||||..")), std::invalid_argument);
+  REQUIRE_THROWS_AS((half_map<4, 2>("||||....|")), std::invalid_argument);
+}
+
+TEST_CASE("maze_generator reuses its buffers", "[maze_builder]") {
+  for (const auto & start : { create_empty_template(40, 30), create_empty_template(64, 64) }) {
+    maze_generator generator(start);
+    for (std::uint64_t seed = 0; seed < 4; seed++) {
+      generator.generate(seed, 2);
+      REQUIRE(packed_map{ generator.state() } == create_random_map(start, seed, 2));
+    }
+
+#ifndef MAZE_BUILDER_VERIFY_INCREMENTAL
+    // The largest map sizes the buffers, after that nothing is allocated.
+    // The incremental checks build their reference state on the heap.
+    for (std::uint64_t seed = 0; seed < 16; seed++)
+      generator.generate(seed);
+    const std::size_t before = allocations;
+    for (std::uint64_t seed = 0; seed < 16; seed++)
+      generator.generate(seed);
+    REQUIRE(allocations == before);
+    create_random_map(start, 0, 0);
+    REQUIRE(allocations > before);
+#endif
+  }
+
+  maze_generator fixed(create_map_template());
+  fixed.generate(3);
+  REQUIRE(packed_map{ fixed.state() } == create_random_map(3, 0));
+}
+
+TEST_CASE("Packed maps hold the walls in bits", "[maze_builder]") {
+  static_assert(std::is_trivially_copyable_v<packed_map<32, 31>>);
+  static_assert(sizeof(packed_map<32, 31>) == 64);
+
+  // Half walls are not a map: mirroring takes a half map or a packed map.
+  static_assert(!std::is_constructible_v<map<32, 31>, bitboard<16, 31>>);
+  static_assert(!std::is_constructible_v<map<32, 31>, board<bool, 16, 31>>);
+
+  const auto packed = create_random_map(8, 0);
+  const map full{ with_walls(create_map_template(), packed) };
+  for (std::size_t y = 0; y < 31; y++) {
+    for (std::size_t x = 0; x < 32; x++)
+      REQUIRE(packed[x, y] == full.walls[x, y]);
+  }
+  REQUIRE(map{ packed }.walls == full.walls);
+  REQUIRE(fmt::format("{:a}", packed) == fmt::format("{:a}", full));
+  REQUIRE(packed != create_random_map(9, 0));
+}
+
+TEST_CASE("Packed mirroring matches the cells", "[maze_builder]") {
+  rng::PCG pcg(12, 0);
+  for (const std::size_t width : { 1uz, 5uz, 16uz, 31uz, 32uz, 33uz, 63uz, 64uz, 65uz, 100uz, 130uz, 1100uz }) {
+    dynamic_half_map hm(width, 3);
+    for (std::size_t y = 0; y < 3; y++) {
+      for (std::size_t x = 0; x < width; x++)
+        hm.walls.set(x, y, pcg() % 2);
+    }
+    const dynamic_map full{ hm };
+    REQUIRE(full.walls.extent.width == 2 * width);
+    for (std::size_t y = 0; y < 3; y++) {
+      for (std::size_t x = 0; x < width; x++) {
+        REQUIRE(full.walls[x, y] == hm.walls[x, y]);
+        REQUIRE(full.walls[2 * width - 1 - x, y] == hm.walls[x, y]);
+      }
+    }
+    REQUIRE(full.walls.bits(0, 0, 64) == full.walls.row(0)[0]);
+    REQUIRE(dynamic_map{ packed_map{ hm } }.walls == full.walls);
+  }
+
+  constexpr map fixed{ create_map_template() };
+  static_assert(fixed.walls[0, 0] && fixed.walls[31, 30]);
+  half_map<16, 31, board<bool, 16, 31>> bytes;
+  for (std::size_t y = 0; y < 31; y++) {
+    for (std::size_t x = 0; x < 16; x++)
+      bytes.walls.set(x, y, create_map_template().walls[x, y]);
+  }
+  REQUIRE(fixed.walls == map{ bytes }.walls);
+}
+
+TEST_CASE("Movement masks match the neighbouring walls", "[maze_builder]") {
+  const auto check = [](const auto & m, const auto & masks, bool wrap) {
+    const int w = static_cast<int>(m.walls.extent.width);
+    const int h = static_cast<int>(m.walls.extent.height);
+    const auto open = [&](int x, int y) {
+      if (wrap)
+        x = (x + w) % w;
+      return x >= 0 && y >= 0 && x < w && y < h && !m.walls[x, y];
+    };
+    for (int y = 0; y < h; y++) {
+      for (int x = 0; x < w; x++) {
+        const bool self = open(x, y);
+        const auto cell_x = static_cast<std::size_t>(x);
+        const auto cell_y = static_cast<std::size_t>(y);
+        REQUIRE(masks.can_move(cell_x, cell_y, direction::up) == (self && open(x, y - 1)));
+        REQUIRE(masks.can_move(cell_x, cell_y, direction::right) == (self && open(x + 1, y)));
+        REQUIRE(masks.can_move(cell_x, cell_y, direction::down) == (self && open(x, y + 1)));
+        REQUIRE(masks.can_move(cell_x, cell_y, direction::left) == (self && open(x - 1, y)));
+        REQUIRE(((masks.packed_row(cell_y)[cell_x / 16] >> (cell_x % 16 * 4)) & 0xf) == masks[cell_x, cell_y]);
+      }
+    }
+  };
+
+  for (std::uint64_t seed = 0; seed < 4; seed++) {
+    const map fixed{ create_random_map(seed, 0) };
+    check(fixed, movement_masks<32, 31, false>(fixed), false);
+    check(fixed, movement_masks<32, 31, true>(fixed), true);
+    const map large{ create_random_map(create_empty_template(70, 20), seed, 0) };
+    check(large, movement_masks<std::dynamic_extent, std::dynamic_extent, false>(large), false);
+    check(large, movement_masks<std::dynamic_extent, std::dynamic_extent, true>(large), true);
+  }
+
+  // Tunnels on both edges, with the masks computed at compile time.
+  constexpr auto tunnel = [] {
+    auto hm = create_empty_template<4, 5>();
+    hm.walls.set(0, 2, false);
+    return map{ hm };
+  }();
+  constexpr movement_masks<8, 5, true> wrapped(tunnel);
+  static_assert(wrapped.can_move(0, 2, direction::left) && wrapped.can_move(7, 2, direction::right));
+  constexpr movement_masks<8, 5, false> bounded(tunnel);
+  static_assert(!bounded.can_move(0, 2, direction::left) && bounded.can_move(0, 2, direction::right));
+  check(tunnel, wrapped, true);
+  check(tunnel, bounded, false);
+}
+
+TEST_CASE("Playability matches a cell by cell check", "[maze_builder]") {
+  const map loop{ parse_template("||||\n|...\n|.||\n|...\n||||\n") };
+  const auto looped = check_playability(loop);
+  REQUIRE(looped.corridor_cells == 14);
+  REQUIRE(looped.playable());
+
+  const auto check = [](const auto & m) {
+    const auto report = check_playability(m);
+    const std::size_t w = m.walls.extent.width;
+    const std::size_t h = m.walls.extent.height;
+    const auto cell = [&](int x, int y) {
+      return static_cast<std::size_t>(y) * w + static_cast<std::size_t>(x);
+    };
+    const auto open = [&](int x, int y) {
+      return x >= 0 && y >= 0 && static_cast<std::size_t>(x) < w && static_cast<std::size_t>(y) < h &&
+             !m.walls[static_cast<std::size_t>(x), static_cast<std::size_t>(y)];
+    };
+
+    std::size_t corridors = 0;
+    std::vector<position> dead_ends;
+    for (int y = 0; y < static_cast<int>(h); y++) {
+      for (int x = 0; x < static_cast<int>(w); x++) {
+        if (!open(x, y))
+          continue;
+        corridors++;
+        if (open(x - 1, y) + open(x + 1, y) + open(x, y - 1) + open(x, y + 1) == 1)
+          dead_ends.push_back({ x, y });
+      }
+    }
+    REQUIRE(report.corridor_cells == corridors);
+    REQUIRE(report.dead_ends == dead_ends);
+
+    std::vector<bool> seen(w * h);
+    std::size_t regions = 0;
+    std::size_t largest = 0;
+    for (int y = 0; y < static_cast<int>(h); y++) {
+      for (int x = 0; x < static_cast<int>(w); x++) {
+        if (!open(x, y) || seen[cell(x, y)])
+          continue;
+        regions++;
+        std::size_t size = 0;
+        std::vector<position> todo{ { x, y } };
+        seen[cell(x, y)] = true;
+        while (!todo.empty()) {
+          const position p = todo.back();
+          todo.pop_back();
+          size++;
+          for (const position n : { position{ p.x + 1, p.y }, position{ p.x - 1, p.y }, position{ p.x, p.y + 1 }, position{ p.x, p.y - 1 } }) {
+            if (open(n.x, n.y) && !seen[cell(n.x, n.y)]) {
+              seen[cell(n.x, n.y)] = true;
+              todo.push_back(n);
+            }
+          }
+        }
+        largest = std::max(largest, size);
+      }
+    }
+    REQUIRE(report.regions == regions);
+    REQUIRE(report.largest_region == largest);
+  };
+
+  for (std::uint64_t seed = 0; seed < 8; seed++) {
+    check(map{ create_random_map(seed, 0) });
+    check(map{ create_random_map(create_empty_template(70, 24), seed, 0) });
+  }
+  dynamic_half_map noise(90, 20);
+  rng::PCG pcg(3, 3);
+  for (std::size_t y = 0; y < 20; y++) {
+    for (std::size_t x = 0; x < 90; x++)
+      noise.walls.set(x, y, pcg() % 3 == 0);
+  }
+  check(map{ noise });
+}
+
+TEST_CASE("Rejected maps fail the constraint they are charged to", "[maze_builder]") {
+  const auto start = create_map_template();
+  using half = decltype(start);
+  const auto density = [](const half & hm) {
+    std::size_t walls = 0;
+    for (const auto & p : hm.all_positions())
+      walls += hm.is_wall(p);
+    return static_cast<double>(walls) / static_cast<double>(hm.extent.width * hm.extent.height);
+  };
+  const auto largest_group = [](const half & hm) {
+    std::size_t largest = 0;
+    for (const auto & p : hm.all_positions())
+      largest = std::max(largest, hm.wall_group_size(p));
+    return largest;
+  };
+
+  rejecting_generator unconstrained(start, {});
+  for (std::uint64_t stream = 0; stream < 4; stream++) {
+    REQUIRE(unconstrained.generate(7, stream));
+    REQUIRE(packed_map{ unconstrained.state() } == create_random_map(7, stream));
+  }
+
+  rejecting_generator generator(start, { constraints::max_density{ 0.62 }, constraints::max_wall_group{ 61 },
+                                         constraints::min_density{ 0.59 }, constraints::connected{} });
+  std::size_t accepted = 0;
+  for (std::uint64_t stream = 0; stream < 200; stream++) {
+    const auto before = generator.stats();
+    const bool passed = generator.generate(1, stream);
+    const auto & after = generator.stats();
+    REQUIRE(after.attempts == before.attempts + 1);
+    const auto & hm = generator.state();
+    REQUIRE(hm.largest_wall_group() == largest_group(hm));
+    if (passed) {
+      accepted++;
+      const auto full = with_walls(start, create_random_map(1, stream));
+      REQUIRE(hm.walls == full.walls);
+      REQUIRE(density(full) <= 0.62);
+      REQUIRE(density(full) >= 0.59);
+      REQUIRE(largest_group(full) <= 61);
+      REQUIRE(check_playability(map{ full }).connected());
+      continue;
+    }
+    // An aborted map stops with the walls that broke the constraint.
+    if (after.constraints[0].aborted > before.constraints[0].aborted)
+      REQUIRE(density(hm) > 0.62);
+    else if (after.constraints[1].aborted > before.constraints[1].aborted)
+      REQUIRE(largest_group(hm) > 61);
+    else if (after.constraints[2].rejected > before.constraints[2].rejected)
+      REQUIRE(density(hm) < 0.59);
+    else {
+      REQUIRE(after.constraints[3].rejected == before.constraints[3].rejected + 1);
+      REQUIRE(!check_playability(map{ hm }).connected());
+    }
+  }
+  const auto stats = generator.take_stats();
+  REQUIRE(stats.attempts == 200);
+  REQUIRE(stats.accepted == accepted);
+  std::size_t turned_down = 0;
+  for (std::size_t i = 0; i < stats.constraints.size(); i++)
+    turned_down += stats.constraints[i].aborted + stats.constraints[i].rejected;
+  REQUIRE(turned_down + accepted == 200);
+  REQUIRE(generator.stats().attempts == 0);
+
+  // The border of the template is a group of 61 walls, so any smaller
+  // limit stops at the first wall.
+  rejecting_generator tight(start, { constraints::max_wall_group{ 60 } });
+  REQUIRE(!tight.generate(0, 0));
+  REQUIRE(tight.stats().constraints[0].aborted == 1);
+}
+
+TEST_CASE("Seeded maps are reproducible", "[maze_builder]") {
+  const auto a = create_random_map(7, 3);
+  const auto b = create_random_map(7, 3);
+  const auto c = create_random_map(7, 4);
+  REQUIRE(a == b);
+  REQUIRE(a != c);
+}
+
+TEST_CASE("Runtime-sized maps match the fixed-size ones", "[maze_builder]") {
+  const auto fixed = create_random_map(create_empty_template<32, 64>(), 11, 2);
+  const auto dynamic = create_random_map(create_empty_template(32, 64), 11, 2);
+  REQUIRE(dynamic.extent.width == 64);
+  REQUIRE(dynamic.extent.height == 64);
+  for (std::size_t y = 0; y < 64; y++) {
+    for (std::size_t x = 0; x < 64; x++)
+      REQUIRE(dynamic[x, y] == fixed[x, y]);
+  }
+
+  const map full{ dynamic };
+  REQUIRE(full.walls.extent.width == 64);
+  REQUIRE(full.walls == dynamic_map{ with_walls(create_empty_template(32, 64), dynamic) }.walls);
+  const map fixed_full{ fixed };
+  for (std::size_t y = 0; y < 64; y++) {
+    for (std::size_t x = 0; x < 64; x++)
+      REQUIRE(full.walls[x, y] == fixed_full.walls[x, y]);
+  }
+}
+
+TEST_CASE("Large runtime-sized maps fill up", "[maze_builder]") {
+  const auto empty = create_empty_template(256, 512);
+  REQUIRE(with_walls(empty, create_random_map(empty, 5, 0)).free_positions.empty());
+}
+
+TEST_CASE("Tiled generation is deterministic and fills the seams", "[maze_builder]") {
+  const auto empty = create_empty_template(96, 80);
+  const auto one = tiled::create_random_map(empty, 9, 1, 24, 20, 1);
+  const auto three = tiled::create_random_map(empty, 9, 1, 24, 20, 3);
+  REQUIRE(one == three);
+  REQUIRE(one != tiled::create_random_map(empty, 9, 1, 32, 16, 3));
+  REQUIRE(with_walls(empty, one).free_positions.empty());
+  REQUIRE_THROWS_AS(tiled::create_random_map(empty, 9, 1, 3, 20, 1), std::invalid_argument);
+
+  // Seams look like the rest of the map: walls are still made of whole
+  // blocks, and corridors are about as wide as without tiles, which leave
+  // over 500 empty 2x2 squares along the seams when they are not redone.
+  const auto empty_squares = [](const auto & walls) {
+    std::size_t count = 0;
+    for (std::size_t y = 0; y + 1 < walls.extent.height; y++) {
+      for (std::size_t x = 0; x + 1 < walls.extent.width; x++)
+        count += walls.none(x, y, 2, 2);
+    }
+    return count;
+  };
+  std::size_t whole_squares = 0;
+  std::size_t tiled_squares = 0;
+  for (std::uint64_t seed = 0; seed < 4; seed++) {
+    const auto whole = create_random_map(empty, seed, 1);
+    const auto tiles = tiled::create_random_map(empty, seed, 1, 24, 20, 3);
+    whole_squares += empty_squares(with_walls(empty, whole).walls);
+    tiled_squares += empty_squares(with_walls(empty, tiles).walls);
+    const map tiled_map{ tiles };
+    for (std::size_t y = 0; y < 80; y++) {
+      for (std::size_t x = 0; x < 96; x++) {
+        if (!tiles[x, y] || empty.walls[x, y])
+          continue;
+        bool in_block = false;
+        for (std::size_t by = y > 0 ? y - 1 : 0; by <= y && by + 1 < 80; by++) {
+          for (std::size_t bx = x > 0 ? x - 1 : 0; bx <= x && bx + 1 < 96; bx++)
+            in_block = in_block || tiled_map.walls.all(bx, by, 2, 2);
+        }
+        REQUIRE(in_block);
+      }
+    }
+  }
+  REQUIRE(tiled_squares <= 2 * whole_squares);
+}
+
+TEST_CASE("Batch output does not depend on the thread count", "[maze_builder]") {
+  auto generate = [](std::size_t threads) {
+    std::vector<std::pair<std::size_t, packed_map<32, 31>>> maps;
+    batch::run(
+      40, threads,
+      [](std::size_t index) { return create_random_map(1234, index); },
+      [&](std::size_t index, const auto & packed) { maps.emplace_back(index, packed); });
+    return maps;
+  };
+  const auto single = generate(1);
+  REQUIRE(single.size() == 40);
+  for (std::size_t i = 0; i < single.size(); i++)
+    REQUIRE(single[i].first == i);
+  REQUIRE(generate(4) == single);
+  REQUIRE(generate(64) == single);
+}
+
+TEST_CASE("Batches stay within their window and stop on errors", "[maze_builder]") {
+  // The consumer's count lags the one batch::run keeps by at most one.
+  constexpr std::size_t threads = 3;
+  std::atomic<std::size_t> consumed = 0;
+  std::atomic<bool> ahead = false;
+  batch::run(
+    200, threads,
+    [&](std::size_t index) {
+      if (index > consumed + threads * batch::slots_per_thread)
+        ahead = true;
+      return index;
+    },
+    [&](std::size_t index, std::size_t result) {
+      REQUIRE(result == index);
+      consumed = index + 1;
+    });
+  REQUIRE(consumed == 200);
+  REQUIRE(!ahead);
+
+  std::atomic<std::size_t> started = 0;
+  const auto failing_generate = [&](std::size_t index) {
+    started++;
+    if (index == 10)
+      throw std::runtime_error("generate failed");
+    return index;
+  };
+  REQUIRE_THROWS_WITH(batch::run(1000, 4, failing_generate, [](std::size_t, std::size_t) {}), "generate failed");
+  REQUIRE(started < 100);
+
+  const auto failing_consume = [](std::size_t index, std::size_t) {
+    if (index == 10)
+      throw std::runtime_error("consume failed");
+  };
+  REQUIRE_THROWS_WITH(batch::run(1000, 4, [](std::size_t index) { return index; }, failing_consume), "consume failed");
+
+  // Jobs that only end when the batch is stopped.
+  const auto endless = [](std::size_t index, std::stop_token stop) {
+    while (index > 10 && !stop.stop_requested())
+      std::this_thread::yield();
+    return index;
+  };
+  REQUIRE_THROWS_WITH(batch::run(100, 4, endless, failing_consume), "consume failed");
+}
+
+TEST_CASE("PCG jump-ahead matches stepping", "[maze_builder]") {
+  constexpr auto stepped = [](rng::PCG pcg, int count) {
+    while (count-- > 0)
+      pcg();
+    return pcg;
+  };
+  static_assert(rng::PCG{}.jumped(30).rng.state == stepped(rng::PCG{}, 30).rng.state);
+
+  rng::PCG pcg(42, 54);
+  REQUIRE(pcg.stream() == 54);
+  REQUIRE(pcg.jumped(1000).rng.state == stepped(pcg, 1000).rng.state);
+
+  auto next = pcg.jumped(1);
+  auto back = next.jumped(~std::uint64_t{ 0 });
+  REQUIRE(back.rng.state == pcg.rng.state);
+
+  // Blocks handed to different workers continue into each other.
+  auto first = pcg.jumped(0);
+  auto second = pcg.jumped(100);
+  first.discard(99);
+  first();
+  REQUIRE(first() == second());
+
+  rng::PCG other = pcg;
+  other.set_stream(55);
+  REQUIRE(other.jumped(10)() != pcg.jumped(10)());
+}